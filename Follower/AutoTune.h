@@ -0,0 +1,161 @@
+#ifndef _AUTOTUNE_H
+#define _AUTOTUNE_H
+
+#include <EEPROM.h>
+
+// 继电反馈自整定（Åström–Hägglund）
+// 输出在 bias ± d 之间切换，速度越过 setpoint ± 滞环 就翻转，
+// 闭环会形成稳定的极限环：幅值 a、周期 Tu
+// 临界增益 Ku = 4d / (π·sqrt(a² - eps²))，再按整定规则换算成 PID_c 的 kp/ki/kd
+// 每个轮子一个实例，update() 按固定周期调用（周期本身也算进回路延时里，最好和PID周期一样）
+
+#define TUNE_SKIP_CYCLES   2      // 前几个周期是过渡过程，不计
+#define TUNE_MEAS_CYCLES   4      // 取平均的周期数
+
+#define TUNE_RULE_ZN_PI    0      // Ziegler-Nichols PI：kp = 0.45Ku, Ti = Tu/1.2
+#define TUNE_RULE_TL_PI    1      // Tyreus-Luyben PI：kp = Ku/3.2, Ti = 2.2Tu，超调更小
+
+#ifndef TUNE_RULE
+#define TUNE_RULE TUNE_RULE_ZN_PI
+#endif
+
+#define TUNE_IDLE     0
+#define TUNE_RUNNING  1
+#define TUNE_DONE     2
+
+class RelayTune_c {
+  public:
+
+    float setpoint;
+    float bias;
+    float d;               // 继电幅值（PWM）
+    float eps;             // 滞环（counts/s）
+
+    byte state;
+    bool high;
+    byte cycles;           // 已完成的完整周期数（以向上翻转计）
+
+    float peak_max;        // 本周期内最大/最小速度
+    float peak_min;
+    float amp_sum;
+    unsigned long last_rise_ms;
+    unsigned long period_sum_ms;
+
+    float ku;
+    float tu_ms;
+
+    RelayTune_c() {
+      state = TUNE_IDLE;
+    }
+
+    void begin( float sp, float bias_pwm, float relay_pwm, float hysteresis, unsigned long now_ms ) {
+      setpoint = sp;
+      bias = bias_pwm;
+      d = relay_pwm;
+      eps = hysteresis;
+      state = TUNE_RUNNING;
+      high = true;
+      cycles = 0;
+      peak_max = -1e9f;
+      peak_min = 1e9f;
+      amp_sum = 0.0f;
+      period_sum_ms = 0;
+      last_rise_ms = now_ms;
+      ku = 0.0f;
+      tu_ms = 0.0f;
+    }
+
+    // 返回这一拍的输出 PWM
+    float update( float speed, unsigned long now_ms ) {
+      if ( state != TUNE_RUNNING ) return bias;
+
+      if ( speed > peak_max ) peak_max = speed;
+      if ( speed < peak_min ) peak_min = speed;
+
+      if ( high && speed > setpoint + eps ) {
+        high = false;
+      } else if ( !high && speed < setpoint - eps ) {
+        high = true;
+
+        // 向上翻转：一个完整周期结束
+        if ( cycles >= TUNE_SKIP_CYCLES ) {
+          amp_sum += ( peak_max - peak_min ) * 0.5f;
+          period_sum_ms += now_ms - last_rise_ms;
+        }
+        cycles++;
+        last_rise_ms = now_ms;
+        peak_max = -1e9f;
+        peak_min = 1e9f;
+
+        if ( cycles >= TUNE_SKIP_CYCLES + TUNE_MEAS_CYCLES ) finish();
+      }
+
+      return high ? bias + d : bias - d;
+    }
+
+    void finish() {
+      float a = amp_sum / TUNE_MEAS_CYCLES;
+      tu_ms = (float)period_sum_ms / TUNE_MEAS_CYCLES;
+      float a2 = a * a - eps * eps;
+      if ( a2 <= 0.0f ) a2 = a * a;
+      ku = 4.0f * d / ( PI * sqrt( a2 ) );
+      state = TUNE_DONE;
+    }
+
+    bool done() {
+      return state == TUNE_DONE;
+    }
+
+    // 换算成 PID_c 的参数（ki 每毫秒）
+    void gains( float &kp, float &ki, float &kd ) {
+#if TUNE_RULE == TUNE_RULE_TL_PI
+      kp = ku / 3.2f;
+      float ti_ms = 2.2f * tu_ms;
+#else
+      kp = 0.45f * ku;
+      float ti_ms = tu_ms / 1.2f;
+#endif
+      ki = kp / ti_ms;
+      kd = 0.0f;
+    }
+
+};
+
+// ---------- EEPROM 里保存的轮速环参数 ----------
+
+#define TUNE_EEPROM_ADDR   0
+#define TUNE_MAGIC         0x5447    // "TG"
+
+struct TunedGains_t {
+  uint16_t magic;
+  float kp[ 2 ];         // 0 = 左，1 = 右，同 DualPID_c
+  float ki[ 2 ];
+  float kd[ 2 ];
+  byte sum;
+};
+
+inline byte tunedGainsSum( const TunedGains_t &g ) {
+  const byte *p = (const byte *)&g;
+  byte s = 0;
+  for ( byte i = 0; i < sizeof( TunedGains_t ) - 1; i++ ) s += p[ i ];
+  return s;
+}
+
+inline void saveTunedGains( TunedGains_t &g ) {
+  g.magic = TUNE_MAGIC;
+  g.sum = tunedGainsSum( g );
+  EEPROM.put( TUNE_EEPROM_ADDR, g );
+}
+
+// 没有保存过或校验不对返回 false
+inline bool loadTunedGains( TunedGains_t &g ) {
+  EEPROM.get( TUNE_EEPROM_ADDR, g );
+  if ( g.magic != TUNE_MAGIC ) return false;
+  if ( g.sum != tunedGainsSum( g ) ) return false;
+  for ( byte i = 0; i < 2; i++ ) {
+    if ( !( g.kp[ i ] > 0.0f ) || !( g.ki[ i ] >= 0.0f ) ) return false;
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef _BUMPTIMER_H
+#define _BUMPTIMER_H
+
+#include <Arduino.h>
+
+// 两路bump同时充电、后台计时的非阻塞读法
+// BUMP_L 4 = PD4，BUMP_R 5 = PC6，32U4 上这两个脚都没有引脚变化中断/外部中断，
+// PD4 的 ICP1 也用不了（Timer1 给电机做 PWM，TOP = ICR1），所以用 Timer4 轮询 PIND/PINC：
+//   - 粗节拍：Timer4 10 位计满一圈（64us）溢出一次，中断里读一次引脚，时间取节拍中点（±32us）
+//   - 细窗口：跟随区间 BUMP_FINE_LO_US–BUMP_FINE_HI_US（128–448us，盖住 sigmoid 150–390us）里
+//     只在上一次落在区间内的读数附近开一个 BUMP_FINE_SPAN_US（128us）宽、对齐节拍的窗口：
+//     到窗口起点那次中断里关掉自己（不会重入）、开总中断，直接循环读引脚，用 TCNT4 打时间戳，分辨率 1us；
+//     编码器 / millis 的中断照常进来，打断时这一路读数最多晚几 us。窗口外的读数是粗节拍的 ±32us
+// 中断负担：粗节拍每 64us 一次（原来每 16us 一次），细窗口每次测量最多占住 128us，两路放完电就提前退出；
+// start( false ) 不开细窗口（调用者知道这次读数用不上，比如锁相环判断 leader 正在发 line）
+// 每次测量的中断占用（从溢出到中断函数返回，细窗口里被别的中断打断的时间也算进去）在 sample.cpu_us 里
+// 读数单位和 readBump() 一样是 us
+// Timer4 会被重新配置：pin 6 / pin 13 上不能再用 analogWrite()（蜂鸣器用 tone() 没问题）
+//
+// 用法：start() 开始一次测量，之后轮询 read()，返回 true 时 sample 里是这次的结果
+//
+// 自适应上限：比下游的判定点（调用者给：LOST_TH，或 mapIRtoCS 查表饱和的读数）多一个节拍就停，
+// 没放完电的通道返回 BUMP_SATURATED（= 原来的超时值），超过判定点的读数下游本来就不区分，判断不变
+// 上限不低于 BUMP_CAP_MIN_US 和基线的 BUMP_CAP_BASE_MULT 倍，细窗口整个落在上限以内
+// 不按标定时看到的没有 leader 的读数定：那个读数常常就是超时值 4500，定出来的上限什么也省不了
+
+#define BUMP_TICK_US     64
+#define BUMP_FINE_LO_US  128
+#define BUMP_FINE_HI_US  448
+#define BUMP_FINE_SPAN_US 128
+#define BUMP_TIMEOUT_US  4500
+#define BUMP_SATURATED   BUMP_TIMEOUT_US
+#define BUMP_CAP_MIN_US  600
+#define BUMP_CAP_BASE_MULT 2
+#define BUMP_SAT_US16    0xFFFF
+
+static_assert( BUMP_FINE_LO_US % BUMP_TICK_US == 0 && BUMP_FINE_HI_US % BUMP_TICK_US == 0 &&
+               BUMP_FINE_SPAN_US % BUMP_TICK_US == 0, "fine window must sit on Timer4 ticks" );
+static_assert( BUMP_FINE_HI_US - BUMP_FINE_LO_US >= BUMP_FINE_SPAN_US, "fine span wider than the following band" );
+static_assert( BUMP_FINE_HI_US < BUMP_CAP_MIN_US, "fine window must end below the smallest cap" );
+
+#define BUMP_L_MASK  ( 1 << PIND4 )
+#define BUMP_R_MASK  ( 1 << PINC6 )
+
+#define BUMP_PEND_L  0x01
+#define BUMP_PEND_R  0x02
+
+struct BumpSample_t {
+  unsigned long left_us;
+  unsigned long right_us;
+  unsigned long t_ms;          // 开始放电的时刻
+  unsigned long t_us;
+  unsigned int cpu_us;         // 这次测量在中断里花的时间
+};
+
+class BumpTimer_c {
+  public:
+
+    volatile uint16_t ticks;
+    volatile byte pending;
+    volatile bool done;
+    volatile uint16_t left_us;
+    volatile uint16_t right_us;
+    volatile uint16_t cpu16;   // 中断占用，1/16us
+    uint16_t cap_ticks;
+    uint16_t fine_centre_us;   // 上一次落在跟随区间里的读数（两路平均），0 = 还没有
+    volatile byte fine_tick;   // 细窗口从第几个节拍开始，0 = 这次不开
+    uint16_t fine_end_us;
+    unsigned long start_ms;
+    unsigned long start_us;
+
+    BumpTimer_c() {
+      pending = 0;
+      done = false;
+      fine_centre_us = 0;
+      fine_tick = 0;
+    }
+
+    // Timer4：普通模式，TOP = TC4H:OCR4C = 1023，不分频，每 1024 个时钟（64us）溢出一次
+    void initialise() {
+      TIMSK4 = 0;
+      TCCR4A = 0;
+      TCCR4C = 0;
+      TCCR4D = 0;
+      TCCR4E = 0;
+      TC4H = ( ( BUMP_TICK_US * 16 ) - 1 ) >> 8;
+      OCR4C = ( ( BUMP_TICK_US * 16 ) - 1 ) & 0xFF;
+      TCCR4B = ( 1 << CS40 );
+      setCap( BUMP_TIMEOUT_US );
+    }
+
+    void setCap( unsigned long cap_us ) {
+      if ( cap_us > BUMP_TIMEOUT_US ) cap_us = BUMP_TIMEOUT_US;
+      cap_ticks = ( cap_us + BUMP_TICK_US - 1 ) / BUMP_TICK_US;
+    }
+
+    // base_us：leader 在正常跟随距离时的读数；decision_us：下游再往上就不区分读数的判定点
+    // 上限放在判定点上方一个节拍，返回实际使用的上限
+    unsigned long calibrateCap( unsigned long base_us, unsigned long decision_us ) {
+      unsigned long cap = decision_us + BUMP_TICK_US;
+      unsigned long floor_us = base_us * BUMP_CAP_BASE_MULT;
+      if ( floor_us < BUMP_CAP_MIN_US ) floor_us = BUMP_CAP_MIN_US;
+      if ( cap < floor_us ) cap = floor_us;
+      if ( cap > BUMP_TIMEOUT_US ) cap = BUMP_TIMEOUT_US;
+      setCap( cap );
+      return cap;
+    }
+
+    bool busy() {
+      return pending != 0;
+    }
+
+    // 正在测量时返回 false；fine = false 时这次只用粗节拍
+    bool start( bool fine = true ) {
+      if ( pending ) return false;
+
+      // 细窗口放在上一次跟随区间读数的两边，起点按四舍五入对齐到节拍，读数离窗口两端至少 32us
+      fine_tick = 0;
+      if ( fine && fine_centre_us ) {
+        uint16_t s = fine_centre_us + BUMP_TICK_US / 2 - BUMP_FINE_SPAN_US / 2;
+        s -= s % BUMP_TICK_US;
+        if ( s < BUMP_FINE_LO_US ) s = BUMP_FINE_LO_US;
+        if ( s > BUMP_FINE_HI_US - BUMP_FINE_SPAN_US ) s = BUMP_FINE_HI_US - BUMP_FINE_SPAN_US;
+        fine_tick = s / BUMP_TICK_US;
+        fine_end_us = s + BUMP_FINE_SPAN_US;
+      }
+
+      // 两路一起充电
+      PORTD |= BUMP_L_MASK;
+      PORTC |= BUMP_R_MASK;
+      DDRD |= BUMP_L_MASK;
+      DDRC |= BUMP_R_MASK;
+      delayMicroseconds( 10 );
+
+      done = false;
+      ticks = 0;
+      cpu16 = 0;
+      start_ms = millis();
+      start_us = micros();
+
+      byte sreg = SREG;
+      cli();
+      // 切成输入（不带上拉）开始放电，同时从节拍起点开始计时
+      DDRD &= ~BUMP_L_MASK;
+      DDRC &= ~BUMP_R_MASK;
+      PORTD &= ~BUMP_L_MASK;
+      PORTC &= ~BUMP_R_MASK;
+      TC4H = 0;
+      TCNT4 = 0;
+      TIFR4 = ( 1 << TOV4 );
+      pending = BUMP_PEND_L | BUMP_PEND_R;
+      TIMSK4 |= ( 1 << TOIE4 );
+      SREG = sreg;
+
+      return true;
+    }
+
+    // 有新结果时返回 true，并清掉完成标志
+    bool read( BumpSample_t &sample ) {
+      if ( !done ) return false;
+      sample.left_us = toMicros( left_us );
+      sample.right_us = toMicros( right_us );
+      sample.t_ms = start_ms;
+      sample.t_us = start_us;
+      sample.cpu_us = cpu16 >> 4;
+      done = false;
+
+      // 两路都在跟随区间里才挪细窗口；line 时隙、看不到 leader 的读数不动它
+      if ( sample.left_us >= BUMP_FINE_LO_US && sample.left_us < BUMP_FINE_HI_US &&
+           sample.right_us >= BUMP_FINE_LO_US && sample.right_us < BUMP_FINE_HI_US ) {
+        fine_centre_us = ( sample.left_us + sample.right_us ) / 2;
+      }
+      return true;
+    }
+
+    unsigned long toMicros( uint16_t us ) {
+      if ( us == BUMP_SAT_US16 ) return BUMP_SATURATED;
+      return us;
+    }
+
+    // 10 位计数值：先读低字节，高两位这时锁存在 TC4H 里
+    static uint16_t counter() {
+      byte lo = TCNT4;
+      return ( (uint16_t)TC4H << 8 ) | lo;
+    }
+
+    // t_us 时刻还在充电状态的通道看一眼引脚，放完电的记下时间
+    byte poll( byte p, uint16_t t_us ) {
+      if ( ( p & BUMP_PEND_L ) && !( PIND & BUMP_L_MASK ) ) {
+        left_us = t_us;
+        p &= ~BUMP_PEND_L;
+      }
+      if ( ( p & BUMP_PEND_R ) && !( PINC & BUMP_R_MASK ) ) {
+        right_us = t_us;
+        p &= ~BUMP_PEND_R;
+      }
+      return p;
+    }
+
+    // 细窗口：在溢出中断里开总中断轮询，TCNT4 每 16 个计数 1us；计数值变小就是绕了一圈
+    // 每圈 64us 里至少要读到一次计数值，别的中断不会占这么久
+    // 进来之前关掉 TOIE4，轮询期间 TIMER4_OVF 不会重入；最多轮询到 fine_end_us
+    byte fine( byte p ) {
+      TIMSK4 &= ~( 1 << TOIE4 );
+      uint16_t base_us = ticks * BUMP_TICK_US;
+      uint16_t last = counter();
+      sei();
+      while ( p ) {
+        uint16_t c = counter();
+        if ( c < last ) base_us += BUMP_TICK_US;
+        last = c;
+        uint16_t t_us = base_us + ( c >> 4 );
+        p = poll( p, t_us );
+        if ( t_us >= fine_end_us ) break;
+      }
+      cli();
+      // 窗口里绕过的圈记进节拍，清掉这期间置起的溢出标志，粗节拍从这里接着数
+      TIFR4 = ( 1 << TOV4 );
+      if ( counter() < last ) base_us += BUMP_TICK_US;
+      ticks = base_us / BUMP_TICK_US;
+      TIMSK4 |= ( 1 << TOIE4 );
+      return p;
+    }
+
+    // 只在 ISR 里调用
+    void tick() {
+      uint16_t n = ++ticks;
+      byte p = poll( pending, n * BUMP_TICK_US - BUMP_TICK_US / 2 );
+
+      uint16_t spent = 0;
+      if ( p && n == fine_tick ) {
+        p = fine( p );
+        spent = ( ticks - n ) * ( BUMP_TICK_US * 16 );
+        n = ticks;
+      }
+
+      if ( n >= cap_ticks ) {
+        if ( p & BUMP_PEND_L ) left_us = BUMP_SAT_US16;
+        if ( p & BUMP_PEND_R ) right_us = BUMP_SAT_US16;
+        p = 0;
+      }
+
+      pending = p;
+      if ( !p ) TIMSK4 &= ~( 1 << TOIE4 );
+      // 从这一拍溢出算起（含进中断的延迟），不含出中断的十几个周期
+      cpu16 += spent + counter();
+      if ( !p ) done = true;
+    }
+
+};
+
+BumpTimer_c bump_timer;
+
+ISR( TIMER4_OVF_vect ) {
+  bump_timer.tick();
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _DISTANCE_H
+#define _DISTANCE_H
+
+#include <Arduino.h>
+
+// 原始读数 -> 距离（mm）
+// 表由 fit_distance_model.py 根据定距离扫描数据生成（DistanceModel.h）：读数升序，分段线性插值
+// 距离可以随读数增大（bump 放电时间）或减小（line ADC 计数），band 是单次读数 95% 置信的半宽
+// 草图目录里没有 DistanceModel.h 时 DISTANCE_MODEL 为 0，下面的函数不存在，控制仍然用原始读数的门限
+#if __has_include("DistanceModel.h")
+#include "DistanceModel.h"
+#define DISTANCE_MODEL 1
+#else
+#define DISTANCE_MODEL 0
+#endif
+
+#define DIST_OUT_OF_RANGE 0xFFFF
+
+// 四舍五入的除法（距离随读数减小时分子是负的）
+long distanceRoundDiv( long num, long den ) {
+  return ( num >= 0 ? num + den / 2 : num - den / 2 ) / den;
+}
+
+// 超出标定的读数范围返回 DIST_OUT_OF_RANGE；band_mm 不为空时写入插值后的置信半宽
+uint16_t distanceFromTable( const uint16_t *raw_tab, const uint16_t *mm_tab, const uint8_t *band_tab,
+                            byte n, unsigned long raw, byte *band_mm ) {
+  uint16_t r0 = pgm_read_word( &raw_tab[ 0 ] );
+  if ( raw < r0 || raw > pgm_read_word( &raw_tab[ n - 1 ] ) ) return DIST_OUT_OF_RANGE;
+
+  byte i = 1;
+  while ( i < n - 1 && raw > pgm_read_word( &raw_tab[ i ] ) ) i++;
+
+  uint16_t ra = pgm_read_word( &raw_tab[ i - 1 ] );
+  uint16_t rb = pgm_read_word( &raw_tab[ i ] );
+  long ma = pgm_read_word( &mm_tab[ i - 1 ] );
+  long mb = pgm_read_word( &mm_tab[ i ] );
+  long span = rb - ra;
+  long f = raw - ra;
+
+  // 手改过的表可能有重复的读数：raw 正好等于它，直接取这个节点
+  if ( span == 0 ) {
+    if ( band_mm ) *band_mm = pgm_read_byte( &band_tab[ i - 1 ] );
+    return ma;
+  }
+
+  if ( band_mm ) {
+    int ba = pgm_read_byte( &band_tab[ i - 1 ] );
+    int bb = pgm_read_byte( &band_tab[ i ] );
+    *band_mm = ba + distanceRoundDiv( ( bb - ba ) * f, span );
+  }
+  return ma + distanceRoundDiv( ( mb - ma ) * f, span );
+}
+
+#ifdef DIST_BUMP_N
+uint16_t bumpDistanceMm( unsigned long raw_us, byte *band_mm = 0 ) {
+  return distanceFromTable( dist_bump_raw, dist_bump_mm, dist_bump_band, DIST_BUMP_N, raw_us, band_mm );
+}
+#endif
+
+#ifdef DIST_LINE_N
+uint16_t lineDistanceMm( unsigned long raw_adc, byte *band_mm = 0 ) {
+  return distanceFromTable( dist_line_raw, dist_line_mm, dist_line_band, DIST_LINE_N, raw_adc, band_mm );
+}
+#endif
+
+#endif
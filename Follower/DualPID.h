@@ -0,0 +1,208 @@
+#ifndef _DUALPID_H
+#define _DUALPID_H
+
+#include "Fix16.h"
+
+// 左右轮一起更新的增量式PID（算法同 PID_c::update）
+// 数据按“结构的数组”存放：每个量一个长度为2的数组，0 = 左，1 = 右
+// dt 由调用者给出（微秒，通常来自调度器实测周期），不再自己调 millis()
+// 同样的输入序列总是得到同样的输出，可以在电脑上逐拍回放
+// FEATURES 是下面的功能位，没打开的那一段编译器直接去掉；
+// 增益、限幅、死区等参数在运行时可改：按键开机时 autoTuneWheels() 会写入新增益，所以增益不做成模板参数
+
+#define PID_ERROR_DEADZONE   0x01
+#define PID_OUTPUT_DEADZONE  0x02
+#define PID_RATE_LIMIT       0x04
+#define PID_FILTER           0x08
+#define PID_MIN_EFFECTIVE    0x10
+#define PID_D_TERM           0x20
+#define PID_CLAMP            0x40
+
+#define PID_L 0
+#define PID_R 1
+
+template <typename T, byte FEATURES>
+class DualPID_c {
+  static_assert( ( FEATURES & ~0x7F ) == 0, "DualPID_c: unknown PID feature bit" );
+
+  public:
+
+    T kp[ 2 ];
+    T ki[ 2 ];           // 每秒（= PID_c 的 ki * 1000，定点下每毫秒的值太小会丢精度）
+    T kd[ 2 ];           // 乘以毫秒，同 PID_c
+
+    T last_error[ 2 ];
+    T prev_error[ 2 ];
+    T feedback[ 2 ];
+
+    T output_min;
+    T output_max;
+    T error_deadzone;
+    T output_deadzone;       // PID_OUTPUT_DEADZONE：|本拍增量| 小于它就不动
+    T max_delta;
+    T output_filter;         // PID_FILTER：新输出的权重，1 = 不滤波
+    T zero_threshold;        // PID_MIN_EFFECTIVE：|输出| 小于它归零，
+    T min_effective_output;  //   小于 min_effective_output 抬到这个值（克服电机死区）
+
+    DualPID_c() {
+    }
+
+    void initialise( float kp_l, float ki_l, float kd_l, float kp_r, float ki_r, float kd_r ) {
+      setGains( PID_L, kp_l, ki_l, kd_l );
+      setGains( PID_R, kp_r, ki_r, kd_r );
+      output_min = numFrom<T>( -255.0f );
+      output_max = numFrom<T>( 255.0f );
+      error_deadzone = T();
+      output_deadzone = T();
+      max_delta = numFrom<T>( 999.0f );
+      output_filter = numFrom<T>( 1.0f );
+      zero_threshold = T();
+      min_effective_output = T();
+      reset();
+    }
+
+    // 参数单位同 PID_c（ki 每毫秒）
+    void setGains( byte ch, float p, float i, float d ) {
+      kp[ ch ] = numFrom<T>( p );
+      ki[ ch ] = numFrom<T>( i * 1000.0f );
+      kd[ ch ] = numFrom<T>( d );
+    }
+
+    void setOutputLimits( float min_output, float max_output ) {
+      output_min = numFrom<T>( min_output );
+      output_max = numFrom<T>( max_output );
+    }
+
+    void reset() {
+      for ( byte ch = 0; ch < 2; ch++ ) {
+        last_error[ ch ] = T();
+        prev_error[ ch ] = T();
+        feedback[ ch ] = T();
+      }
+    }
+
+    // dt_us == 0 时不更新，返回 false，out 为当前输出
+    bool update( const T demand[ 2 ], const T measurement[ 2 ], unsigned long dt_us, T out[ 2 ] ) {
+      if ( dt_us == 0 ) {
+        out[ PID_L ] = feedback[ PID_L ];
+        out[ PID_R ] = feedback[ PID_R ];
+        return false;
+      }
+
+      // 两个轮子共用一次 dt 换算
+      T dt_s = numFromMicros<T>( dt_us );
+
+      for ( byte ch = 0; ch < 2; ch++ ) {
+        T error = demand[ ch ] - measurement[ ch ];
+
+        if ( FEATURES & PID_ERROR_DEADZONE ) {
+          if ( fabs( error ) < error_deadzone ) error = T();
+        }
+
+        T delta_output = kp[ ch ] * ( error - last_error[ ch ] ) + ki[ ch ] * dt_s * error;
+
+        if ( FEATURES & PID_D_TERM ) {
+          T dd = error - last_error[ ch ] - last_error[ ch ] + prev_error[ ch ];
+          delta_output += kd[ ch ] * dd / ( dt_s * numFrom<T>( 1000.0f ) );
+        }
+
+        if ( FEATURES & PID_OUTPUT_DEADZONE ) {
+          if ( fabs( delta_output ) < output_deadzone ) delta_output = T();
+        }
+
+        if ( FEATURES & PID_RATE_LIMIT ) {
+          if ( delta_output > max_delta ) delta_output = max_delta;
+          else if ( delta_output < -max_delta ) delta_output = -max_delta;
+        }
+
+        T fb = feedback[ ch ] + delta_output;
+
+        if ( FEATURES & PID_CLAMP ) {
+          if ( fb > output_max ) fb = output_max;
+          else if ( fb < output_min ) fb = output_min;
+        }
+
+        if ( FEATURES & PID_FILTER ) {
+          fb = output_filter * fb + ( numFrom<T>( 1.0f ) - output_filter ) * feedback[ ch ];
+        }
+
+        if ( FEATURES & PID_MIN_EFFECTIVE ) {
+          T abs_fb = fabs( fb );
+          if ( abs_fb < zero_threshold ) fb = T();
+          else if ( abs_fb < min_effective_output ) fb = ( fb > T() ) ? min_effective_output : -min_effective_output;
+        }
+
+        feedback[ ch ] = fb;
+        prev_error[ ch ] = last_error[ ch ];
+        last_error[ ch ] = error;
+        out[ ch ] = fb;
+      }
+
+      return true;
+    }
+
+};
+
+#ifdef PID_BENCHMARK
+#include "PID.h"
+// 原来的 pidL / pidR（两个 float PID_c，默认参数 = 只有 ±255 限幅）和 wheel_pid（DualPID_c<Fix16, PID_CLAMP>）
+// 用同一串 demand / 测量值各更新 n 拍，连同 taskPID 里 float <-> Fix16 的换算一起算
+// PID_c::update() 自己调 millis()，同一毫秒里 dt = 0 会直接返回：每拍先把 ms_last_t 拨回 40ms，
+// 拨时钟这一步单独跑一遍计时后扣掉。输出每拍（两个轮子）的平均时间和 CPU 周期数
+void pidBenchmark( unsigned int n, float kp_l, float ki_l, float kd_l, float kp_r, float ki_r, float kd_r ) {
+  volatile float sink = 0.0f;
+  unsigned long t;
+
+  PID_c pid_l;
+  PID_c pid_r;
+  pid_l.initialise( kp_l, ki_l, kd_l );
+  pid_r.initialise( kp_r, ki_r, kd_r );
+  DualPID_c<Fix16, PID_CLAMP> pid;
+  pid.initialise( kp_l, ki_l, kd_l, kp_r, ki_r, kd_r );
+
+  t = micros();
+  for ( unsigned int i = 0; i < n; i++ ) {
+    unsigned long back = millis() - 40;
+    pid_l.ms_last_t = back;
+    pid_r.ms_last_t = back;
+    sink = 200.0f + ( i & 63 );
+  }
+  unsigned long t_clock = micros() - t;
+
+  t = micros();
+  for ( unsigned int i = 0; i < n; i++ ) {
+    unsigned long back = millis() - 40;
+    pid_l.ms_last_t = back;
+    pid_r.ms_last_t = back;
+    float m = 200.0f + ( i & 63 );
+    sink = pid_l.update( 250.0f, m ) + pid_r.update( 250.0f, m + 5.0f );
+  }
+  unsigned long t_float = micros() - t;
+
+  t = micros();
+  for ( unsigned int i = 0; i < n; i++ ) {
+    float m = 200.0f + ( i & 63 );
+    Fix16 demand[ 2 ] = { Fix16( 250.0f ), Fix16( 250.0f ) };
+    Fix16 meas[ 2 ] = { Fix16( m ), Fix16( m + 5.0f ) };
+    Fix16 u[ 2 ];
+    pid.update( demand, meas, 40000UL, u );
+    sink = u[ PID_L ].toFloat() + u[ PID_R ].toFloat();
+  }
+  unsigned long t_fix = micros() - t;
+  (void)sink;
+
+  t_float = ( t_float > t_clock ) ? t_float - t_clock : 0;
+
+  Serial.println( "Path,us_per_tick,cycles_per_tick" );
+  Serial.print( "PID_c_float_x2," );
+  Serial.print( (float)t_float / n );
+  Serial.print( "," );
+  Serial.println( (float)t_float * 16.0f / n );
+  Serial.print( "DualPID_c_fix16," );
+  Serial.print( (float)t_fix / n );
+  Serial.print( "," );
+  Serial.println( (float)t_fix * 16.0f / n );
+}
+#endif
+
+#endif
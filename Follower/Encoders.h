@@ -6,77 +6,286 @@
 #define ENCODER_0_B_PIN  23
 #define ENCODER_1_A_PIN  26
 
+// 端口寄存器位置（3Pi+ 32U4）
+// E0: A = PE6 (XOR), B = PF0
+// E1: A = PB4 (XOR), B = PE2
+#define E0_A_BIT  PINE6
+#define E0_B_BIT  PINF0
+#define E1_A_BIT  PINB4
+#define E1_B_BIT  PINE2
+
 volatile long count_e0;
 volatile byte state_e0;
 volatile long count_e1;
 volatile byte state_e1;
 
-ISR( INT6_vect ) {
-  boolean e0_B = digitalRead( ENCODER_0_B_PIN );
-  boolean e0_A = digitalRead( ENCODER_0_A_PIN );
+// 每个轮子最近一个有效边沿的时间（micros）
+volatile unsigned long edge_us_e0;
+volatile unsigned long edge_us_e1;
+
+// 编码器一致快照：两个计数 + 边沿时间在同一次关中断内取出
+// 32位变量在8位AVR上读取不是原子的，直接读count_e0可能读到ISR改了一半的值
+struct EncoderSnapshot_t {
+  long e0;
+  long e1;
+  unsigned long t_e0;
+  unsigned long t_e1;
+};
+
+// 只在拷贝16个字节期间关中断，之后恢复原来的SREG
+inline void readEncoders( EncoderSnapshot_t &snap ) {
+  byte sreg = SREG;
+  cli();
+  snap.e0 = count_e0;
+  snap.e1 = count_e1;
+  snap.t_e0 = edge_us_e0;
+  snap.t_e1 = edge_us_e1;
+  SREG = sreg;
+}
 
-  e0_A = e0_A ^ e0_B;
+// 编码器边沿时间戳环形缓冲区（单生产者ISR / 单消费者loop）
+// ISR只写head，loop只写tail，满了就丢弃新边沿并置overflow
+#define ENC_EDGE_BUF 16   // 必须是2的幂
+
+struct EdgeRing_t {
+  volatile unsigned long t_us[ ENC_EDGE_BUF ];
+  volatile int8_t dir[ ENC_EDGE_BUF ];
+  volatile byte head;
+  volatile byte tail;
+  volatile bool overflow;
+};
+
+EdgeRing_t edges_e0;
+EdgeRing_t edges_e1;
+
+inline void pushEdge( EdgeRing_t &r, unsigned long t, int8_t d ) {
+  byte next = ( r.head + 1 ) & ( ENC_EDGE_BUF - 1 );
+  if ( next == r.tail ) {
+    r.overflow = true;
+    return;
+  }
+  r.t_us[ r.head ] = t;
+  r.dir[ r.head ] = d;
+  r.head = next;
+}
+
+inline bool popEdge( EdgeRing_t &r, unsigned long &t, int8_t &d ) {
+  byte tail = r.tail;
+  if ( tail == r.head ) return false;
+  t = r.t_us[ tail ];
+  d = r.dir[ tail ];
+  r.tail = ( tail + 1 ) & ( ENC_EDGE_BUF - 1 );
+  return true;
+}
 
-  state_e0 = state_e0 | ( e0_B  << 3 );
-  state_e0 = state_e0 | ( e0_A  << 2 );
-
-  if ( state_e0 == 1 ) {
-    count_e0--;
-  } else if ( state_e0 == 2) {
-    count_e0++;
-  } else if ( state_e0 == 4) {
-    count_e0++;
-  } else if ( state_e0 == 7) {
-    count_e0--;
-  } else if ( state_e0 == 8) {
-    count_e0--;
-  } else if ( state_e0 == 11) {
-    count_e0++;
-  } else if ( state_e0 == 13) {
-    count_e0++;
-  } else if ( state_e0 == 14) {
-    count_e0--;
+// 状态 = (新B << 3) | (新A << 2) | (旧B << 1) | 旧A
+// 与原if/else链的增减一致：1,7,8,14 -> -1；2,4,11,13 -> +1；其余为0
+const int8_t enc_step_table[16] = {
+   0, -1, +1,  0,
+  +1,  0,  0, -1,
+  -1,  0,  0, +1,
+   0, +1, -1,  0
+};
+
+// 中断函数体单独拿出来，ENCODERS_BENCHMARK 量的就是这一段
+inline void handleEncoder0() {
+  byte e0_B = ( PINF >> E0_B_BIT ) & 1;
+  byte e0_A = ( ( PINE >> E0_A_BIT ) & 1 ) ^ e0_B;
+
+  byte s = state_e0 | ( e0_B << 3 ) | ( e0_A << 2 );
+  int8_t step = enc_step_table[ s ];
+  if ( step != 0 ) {
+    unsigned long t = micros();
+    count_e0 += step;
+    edge_us_e0 = t;
+    pushEdge( edges_e0, t, step );
   }
+  state_e0 = s >> 2;
+}
 
-  state_e0 = state_e0 >> 2;
+inline void handleEncoder1() {
+  byte e1_B = ( PINE >> E1_B_BIT ) & 1;
+  byte e1_A = ( ( PINB >> E1_A_BIT ) & 1 ) ^ e1_B;
+
+  byte s = state_e1 | ( e1_B << 3 ) | ( e1_A << 2 );
+  int8_t step = enc_step_table[ s ];
+  if ( step != 0 ) {
+    unsigned long t = micros();
+    count_e1 += step;
+    edge_us_e1 = t;
+    pushEdge( edges_e1, t, step );
+  }
+  state_e1 = s >> 2;
+}
 
+ISR( INT6_vect ) {
+  handleEncoder0();
 }
 
 ISR( PCINT0_vect ) {
+  handleEncoder1();
+}
 
-  boolean e1_B = PINE & (1 << PINE2);
+#ifdef ENCODERS_BENCHMARK
+// 原来 ISR 里的写法（两次 digitalRead + if/else 链）和现在的中断函数体 handleEncoder0() 各跑 n 次，
+// 输出每次的平均时间和 CPU 周期数（不含进出中断本身的开销，两种写法这部分一样）
+// handleEncoder0() 分两种情况量：
+//   - edge：每次先把 state_e0 改成和引脚差一位，走到计数 + micros() + pushEdge()；
+//     环形缓冲区每次清空，不会走到满了丢弃的短路径。改 state_e0 / tail 这一步单独计时后扣掉
+//   - no_edge：引脚没变就进了中断（查表得 0）
+// 会改 count_e0 / state_e0 / edges_e0，要在 setupEncoder0() 之前调用（车不要动）
+void encoderBenchmark( unsigned int n ) {
+  volatile long count = 0;
+  volatile byte state = 0;
+  unsigned long t;
+
+  t = micros();
+  for ( unsigned int i = 0; i < n; i++ ) {
+    boolean e0_B = digitalRead( ENCODER_0_B_PIN );
+    boolean e0_A = digitalRead( ENCODER_0_A_PIN );
+    e0_A = e0_A ^ e0_B;
+    byte s = state | ( e0_B << 3 ) | ( e0_A << 2 );
+    if ( s == 1 ) {
+      count--;
+    } else if ( s == 2 ) {
+      count++;
+    } else if ( s == 4 ) {
+      count++;
+    } else if ( s == 7 ) {
+      count--;
+    } else if ( s == 8 ) {
+      count--;
+    } else if ( s == 11 ) {
+      count++;
+    } else if ( s == 13 ) {
+      count++;
+    } else if ( s == 14 ) {
+      count--;
+    }
+    state = s >> 2;
+  }
+  unsigned long t_old = micros() - t;
+
+  // 现在引脚对应的状态，改一位就是合法的一步
+  byte e0_B = ( PINF >> E0_B_BIT ) & 1;
+  byte e0_A = ( ( PINE >> E0_A_BIT ) & 1 ) ^ e0_B;
+  byte here = ( e0_B << 1 ) | e0_A;
+  byte moved = here ^ 1;
+  edges_e0.head = 0;
+  edges_e0.tail = 0;
+
+  t = micros();
+  for ( unsigned int i = 0; i < n; i++ ) {
+    state_e0 = moved;
+    edges_e0.tail = edges_e0.head;
+  }
+  unsigned long t_reset = micros() - t;
 
-  boolean e1_A = digitalRead( ENCODER_1_A_PIN );
+  t = micros();
+  for ( unsigned int i = 0; i < n; i++ ) {
+    state_e0 = moved;
+    edges_e0.tail = edges_e0.head;
+    handleEncoder0();
+  }
+  unsigned long t_edge = micros() - t;
 
-  e1_A = e1_A ^ e1_B;
+  t = micros();
+  for ( unsigned int i = 0; i < n; i++ ) {
+    handleEncoder0();
+  }
+  unsigned long t_idle = micros() - t;
+
+  t_edge = ( t_edge > t_reset ) ? t_edge - t_reset : 0;
+
+  Serial.println( "Path,us_per_call,cycles_per_call" );
+  Serial.print( "digitalRead_chain," );
+  Serial.print( (float)t_old / n );
+  Serial.print( "," );
+  Serial.println( (float)t_old * 16.0f / n );
+  Serial.print( "isr_body_edge," );
+  Serial.print( (float)t_edge / n );
+  Serial.print( "," );
+  Serial.println( (float)t_edge * 16.0f / n );
+  Serial.print( "isr_body_no_edge," );
+  Serial.print( (float)t_idle / n );
+  Serial.print( "," );
+  Serial.println( (float)t_idle * 16.0f / n );
+}
+#endif
 
-  state_e1 = state_e1 | ( e1_B  << 3 );
-  state_e1 = state_e1 | ( e1_A  << 2 );
-
-  if ( state_e1 == 1 ) {
-    count_e1--;
-  } else if ( state_e1 == 2) {
-    count_e1++;
-  } else if ( state_e1 == 4) {
-    count_e1++;
-  } else if ( state_e1 == 7) {
-    count_e1--;
-  } else if ( state_e1 == 8) {
-    count_e1--;
-  } else if ( state_e1 == 11) {
-    count_e1++;
-  } else if ( state_e1 == 13) {
-    count_e1++;
-  } else if ( state_e1 == 14) {
-    count_e1--;
+#ifdef ENCODERS_PIN_LOG
+// 给 check_encoder_decoder.py --pins 录一段真实的引脚序列：
+// 关掉两个编码器中断，轮询 PINB / PINE / PINF，两个 XOR 脚（E0 的 PE6、E1 的 PB4，
+// 也就是会触发 INT6 / PCINT4 的脚）有变化就记下三个字节，第一条是开始时的状态
+// 期间用手正反转两个轮子；记满 n 条（最多 ENC_PIN_LOG_N）后逐行打印 "PINB,PINE,PINF"（十六进制），
+// 再恢复中断。要在 setupEncoder0() / setupEncoder1() 之后调用（引脚方向和上拉在那里设）
+#define ENC_PIN_LOG_N 150
+
+void encoderPinLog( unsigned int n ) {
+  static byte log_b[ ENC_PIN_LOG_N ];
+  static byte log_e[ ENC_PIN_LOG_N ];
+  static byte log_f[ ENC_PIN_LOG_N ];
+  if ( n > ENC_PIN_LOG_N ) n = ENC_PIN_LOG_N;
+
+  byte eimsk = EIMSK;
+  byte pcicr = PCICR;
+  EIMSK &= ~( 1 << INT6 );
+  PCICR &= ~( 1 << PCIE0 );
+
+  Serial.println( "ENC_PIN_LOG: turn both wheels by hand" );
+  byte b = PINB;
+  byte e = PINE;
+  byte f = PINF;
+  log_b[ 0 ] = b;
+  log_e[ 0 ] = e;
+  log_f[ 0 ] = f;
+  byte xor_b = b & ( 1 << E1_A_BIT );
+  byte xor_e = e & ( 1 << E0_A_BIT );
+  unsigned int k = 1;
+  while ( k < n ) {
+    b = PINB;
+    e = PINE;
+    f = PINF;
+    if ( ( b & ( 1 << E1_A_BIT ) ) != xor_b || ( e & ( 1 << E0_A_BIT ) ) != xor_e ) {
+      log_b[ k ] = b;
+      log_e[ k ] = e;
+      log_f[ k ] = f;
+      xor_b = b & ( 1 << E1_A_BIT );
+      xor_e = e & ( 1 << E0_A_BIT );
+      k++;
+    }
   }
 
-  state_e1 = state_e1 >> 2;
+  Serial.println( "PINB,PINE,PINF" );
+  for ( unsigned int i = 0; i < n; i++ ) {
+    Serial.print( log_b[ i ], HEX );
+    Serial.print( "," );
+    Serial.print( log_e[ i ], HEX );
+    Serial.print( "," );
+    Serial.println( log_f[ i ], HEX );
+  }
+
+  // 录的时候计数没动：按现在的引脚重新取状态，再清掉录的时候挂起的中断标志
+  byte sreg = SREG;
+  cli();
+  byte e0_B = ( PINF >> E0_B_BIT ) & 1;
+  state_e0 = ( e0_B << 1 ) | ( ( ( PINE >> E0_A_BIT ) & 1 ) ^ e0_B );
+  byte e1_B = ( PINE >> E1_B_BIT ) & 1;
+  state_e1 = ( e1_B << 1 ) | ( ( ( PINB >> E1_A_BIT ) & 1 ) ^ e1_B );
+  EIFR = ( 1 << INTF6 );
+  PCIFR = ( 1 << PCIF0 );
+  EIMSK = eimsk;
+  PCICR = pcicr;
+  SREG = sreg;
 }
+#endif
 
 void setupEncoder0()
 {
   count_e0 = 0;
+  edges_e0.head = 0;
+  edges_e0.tail = 0;
+  edges_e0.overflow = false;
 
   pinMode( ENCODER_0_A_PIN, INPUT );
   pinMode( ENCODER_0_B_PIN, INPUT );
@@ -103,6 +312,9 @@ void setupEncoder0()
 void setupEncoder1(){
 
   count_e1 = 0;
+  edges_e1.head = 0;
+  edges_e1.tail = 0;
+  edges_e1.overflow = false;
 
   DDRE = DDRE & ~(1 << DDE6);
 
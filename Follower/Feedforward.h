@@ -0,0 +1,100 @@
+#ifndef _FEEDFORWARD_H
+#define _FEEDFORWARD_H
+
+#include <EEPROM.h>
+
+// 每个轮子一张 PWM -> 稳态速度 表，启动时扫一遍得到
+// 表按 PWM 等间隔（0, STEP, 2*STEP, ...），只存速度，并保证单调不减
+// 前馈时反查：给定目标速度，插值得到需要的 PWM；表头速度为0的那几格就是静摩擦死区
+
+#define FF_POINTS     16
+#define FF_PWM_STEP   4         // 0..60，正好覆盖 Follower 的 PWM_MAX
+
+#define FF_EEPROM_ADDR  32      // 放在自整定参数后面
+#define FF_MAGIC        0x4646  // "FF"
+
+struct FFTable_t {
+  uint16_t magic;
+  int16_t cps[ 2 ][ FF_POINTS ];   // 0 = 左，1 = 右
+  byte sum;
+};
+
+class WheelFF_c {
+  public:
+
+    int16_t cps[ FF_POINTS ];
+    bool valid;
+
+    WheelFF_c() {
+      valid = false;
+    }
+
+    // 扫描结果写进来后调用，强制单调
+    void makeMonotone() {
+      if ( cps[ 0 ] < 0 ) cps[ 0 ] = 0;
+      for ( byte i = 1; i < FF_POINTS; i++ ) {
+        if ( cps[ i ] < cps[ i - 1 ] ) cps[ i ] = cps[ i - 1 ];
+      }
+      valid = ( cps[ FF_POINTS - 1 ] > 0 );
+    }
+
+    // 开始转动的 PWM（死区上沿）
+    float deadzonePWM() {
+      for ( byte i = 0; i < FF_POINTS; i++ ) {
+        if ( cps[ i ] > 0 ) return ( i == 0 ) ? 0.0f : (float)( ( i - 1 ) * FF_PWM_STEP );
+      }
+      return (float)( ( FF_POINTS - 1 ) * FF_PWM_STEP );
+    }
+
+    // 目标速度 -> PWM，超出表的部分按最后一格
+    float pwmFor( float demand ) {
+      if ( demand < 0.0f ) return -pwmFor( -demand );
+      if ( demand == 0.0f ) return 0.0f;
+
+      for ( byte i = 1; i < FF_POINTS; i++ ) {
+        if ( cps[ i ] >= demand ) {
+          float lo = cps[ i - 1 ];
+          float hi = cps[ i ];
+          float f = ( hi > lo ) ? ( demand - lo ) / ( hi - lo ) : 1.0f;
+          return ( ( i - 1 ) + f ) * FF_PWM_STEP;
+        }
+      }
+      return (float)( ( FF_POINTS - 1 ) * FF_PWM_STEP );
+    }
+
+};
+
+inline byte ffTableSum( const FFTable_t &t ) {
+  const byte *p = (const byte *)&t;
+  byte s = 0;
+  for ( byte i = 0; i < sizeof( FFTable_t ) - 1; i++ ) s += p[ i ];
+  return s;
+}
+
+inline void saveFeedforward( WheelFF_c &l, WheelFF_c &r ) {
+  FFTable_t t;
+  t.magic = FF_MAGIC;
+  for ( byte i = 0; i < FF_POINTS; i++ ) {
+    t.cps[ 0 ][ i ] = l.cps[ i ];
+    t.cps[ 1 ][ i ] = r.cps[ i ];
+  }
+  t.sum = ffTableSum( t );
+  EEPROM.put( FF_EEPROM_ADDR, t );
+}
+
+// 没有保存过或校验不对返回 false
+inline bool loadFeedforward( WheelFF_c &l, WheelFF_c &r ) {
+  FFTable_t t;
+  EEPROM.get( FF_EEPROM_ADDR, t );
+  if ( t.magic != FF_MAGIC ) return false;
+  if ( t.sum != ffTableSum( t ) ) return false;
+  for ( byte i = 0; i < FF_POINTS; i++ ) {
+    l.cps[ i ] = t.cps[ 0 ][ i ];
+    r.cps[ i ] = t.cps[ 1 ][ i ];
+  }
+  l.makeMonotone();
+  r.makeMonotone();
+  return l.valid && r.valid;
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef _FIX16_H
+#define _FIX16_H
+
+#include <Arduino.h>
+
+// Q16.16 定点数，给没有FPU的AVR用
+// 乘法拆成4个16x16乘法，避免调用64位乘法库函数
+struct Fix16 {
+  long raw;
+
+  constexpr Fix16() : raw( 0 ) {}
+  constexpr explicit Fix16( float f ) : raw( (long)( f * 65536.0f + ( f >= 0.0f ? 0.5f : -0.5f ) ) ) {}
+
+  static Fix16 fromRaw( long r ) {
+    Fix16 v;
+    v.raw = r;
+    return v;
+  }
+
+  static Fix16 fromInt( int i ) {
+    return fromRaw( (long)i << 16 );
+  }
+
+  float toFloat() const {
+    return (float)raw * ( 1.0f / 65536.0f );
+  }
+
+  Fix16 operator+( Fix16 b ) const { return fromRaw( raw + b.raw ); }
+  Fix16 operator-( Fix16 b ) const { return fromRaw( raw - b.raw ); }
+  Fix16 operator-() const { return fromRaw( -raw ); }
+  Fix16 &operator+=( Fix16 b ) { raw += b.raw; return *this; }
+  Fix16 &operator-=( Fix16 b ) { raw -= b.raw; return *this; }
+
+  Fix16 operator*( Fix16 b ) const {
+    bool neg = false;
+    unsigned long a = raw;
+    unsigned long c = b.raw;
+    if ( raw < 0 ) { a = -raw; neg = !neg; }
+    if ( b.raw < 0 ) { c = -b.raw; neg = !neg; }
+
+    unsigned int ah = a >> 16, al = a & 0xFFFF;
+    unsigned int ch = c >> 16, cl = c & 0xFFFF;
+
+    unsigned long r = ( (unsigned long)ah * ch ) << 16;
+    r += (unsigned long)ah * cl;
+    r += (unsigned long)al * ch;
+    r += ( (unsigned long)al * cl ) >> 16;
+
+    return fromRaw( neg ? -(long)r : (long)r );
+  }
+
+  // 除法用得很少（只在D项），直接用64位
+  Fix16 operator/( Fix16 b ) const {
+    return fromRaw( (long)( ( (int64_t)raw << 16 ) / b.raw ) );
+  }
+
+  bool operator<( Fix16 b ) const { return raw < b.raw; }
+  bool operator>( Fix16 b ) const { return raw > b.raw; }
+  bool operator<=( Fix16 b ) const { return raw <= b.raw; }
+  bool operator>=( Fix16 b ) const { return raw >= b.raw; }
+  bool operator==( Fix16 b ) const { return raw == b.raw; }
+};
+
+inline Fix16 fabs( Fix16 v ) {
+  return v.raw < 0 ? -v : v;
+}
+
+// 给模板统一用：float 和 Fix16 都能这样构造/取值
+template <typename T> constexpr T numFrom( float f ) { return T( f ); }
+inline float numToFloat( float v ) { return v; }
+inline float numToFloat( Fix16 v ) { return v.toFloat(); }
+
+// 微秒 -> 秒
+template <typename T> T numFromMicros( unsigned long us );
+
+template <> inline float numFromMicros<float>( unsigned long us ) {
+  return (float)us * 0.000001f;
+}
+
+// us * 0.065536，4295/65536 ≈ 0.065537；us * 4295 在 999992us 以上会超出 32 位，限制在 0.999s
+template <> inline Fix16 numFromMicros<Fix16>( unsigned long us ) {
+  if ( us > 999000UL ) us = 999000UL;
+  return Fix16::fromRaw( (long)( ( us * 4295UL ) >> 16 ) );
+}
+
+#endif
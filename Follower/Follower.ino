@@ -1,8 +1,45 @@
+#define KINEMATICS_FIXED_POINT 1
+#define KINEMATICS_INTEGRATION  KIN_ARC
+// #define MOTORS_PWM_MODE MOTORS_PWM_20K   // 换PWM频率后需要重新扫前馈表/自整定
+// #define MOTORS_BENCHMARK
+// #define LINE_SENSORS_BENCHMARK
+// #define IRMAP_BENCHMARK
+// #define ENCODERS_BENCHMARK
+// #define ENCODERS_PIN_LOG                 // 上电后用手转轮子，录编码器端口的原始字节给 check_encoder_decoder.py --pins
+// #define KINEMATICS_BENCHMARK
+// #define PID_BENCHMARK
+// #define ODOMETRY_LOG                     // 停车时打印 e0,e1 累计计数，给 calibrate_odometry.py 标定轮径/轮距
+#define BUMP_ASYNC 1                        // 0 = 用阻塞的 readBump()
+
+#include "Tdma.h"                           // IR_MUX 要在 LineSensors.h 之前确定
+
+#if IR_MUX == IR_MUX_FDM
+// 频分：左 bump 也进后台ADC，每路同时解 line / bump 两个载波
+// 窗口 64 轮（6 路约 45ms）：32 轮时灯光闪烁漏进解调幅度的噪声底有 4.3 ± 1.5 计数，信号约 50，占 9%；
+// 64 轮降到 2.1 ± 1.0（simulate_fdm.py，闪烁 60 计数 @ 100Hz）
+#define LINE_ADC_LOCKIN   1
+#define LINE_LOCKIN_BANK  2
+#define LINE_ADC_BUMP_L   1
+#define LINE_LOCKIN_SHIFT 6
+#endif
+
 #include "Encoders.h"
 #include "Motors.h"
-#include "PID.h"
+#include "DualPID.h"
 #include "Kinematics.h"
 #include "LineSensors.h"
+#include "WheelSpeed.h"
+#include "Scheduler.h"
+#include "PoseHistory.h"
+#include "AutoTune.h"
+#include "Feedforward.h"
+#include "BumpTimer.h"
+#include "IrPll.h"
+#include "IrMap.h"
+#include "Distance.h"
+#ifdef ODOMETRY_LOG
+#include "OdometryLog.h"
+#endif
 
 #define BUMP_L 4
 #define BUMP_R 5
@@ -12,9 +49,13 @@
 
 Motors_c motors;
 Kinematics_c kin;
-PID_c pidL;
-PID_c pidR;
 LineSensors_c line_sensors;
+WheelSpeed_c wsL;
+WheelSpeed_c wsR;
+PoseHistory_c pose_hist;
+#ifdef ODOMETRY_LOG
+OdometryLog_c odo_log;
+#endif
 
 unsigned long bump_base = 0;
 int line_L_base = 0;
@@ -22,29 +63,104 @@ int line_R_base = 0;
 
 unsigned long beep_off_time = 0;
 unsigned long t0 = 0;
-
-unsigned long ts_est = 0;
-unsigned long ts_pid = 0;
+Tdma_c tdma;                  // 没锁相时按 t0 推算 leader 的时隙
+
+#define EST_PERIOD_MS   20
+#define PID_PERIOD_MS   40
+#define SENSE_PERIOD_MS ( TDMA_SLOT_MS / 4 )   // 20ms 时隙 5ms 一拍，10ms 时隙 2ms 一拍
+
+// 时隙去掉两端保护带以后至少要放进两次 bump 读数，锁相环才看得到每个半周期；
+// IrPll_c::inBumpWindow() 两端各去掉两倍保护带，剩下的部分至少要放进一次
+static_assert( TDMA_SLOT_MS - 2 * TDMA_GUARD_MS >= 2 * SENSE_PERIOD_MS,
+               "SENSE_PERIOD_MS too long for the guarded TDMA slot" );
+static_assert( TDMA_SLOT_MS - 4 * TDMA_GUARD_MS >= SENSE_PERIOD_MS,
+               "IrPll_c bump window shorter than SENSE_PERIOD_MS" );
 float spdL = 0.0f;
 float spdR = 0.0f;
-long last_e0 = 0;
-long last_e1 = 0;
 
 float demand_cs = 0.0f;
+float steer_cs = 0.0f;        // 左轮加、右轮减；只有频分时有方向信息
 unsigned long last_raw = 200;
 
-const float KP_L = 0.04025f;
-const float KI_L = 0.00005f;
-const float KD_L = 0.0f;
-
-const float KP_R = 0.07000f;
-const float KI_R = 0.00005f;
-const float KD_R = 0.0f;
-
+// leader 按 Tdma.h 的时间表切换 bump/line 发射；BUMP_ASYNC 时用锁相环跟踪它的帧
+IrPll_c ir_pll;
+
+// 后台 bump 测量在中断里花的时间（us），停车时和锁相环状态一起打印
+unsigned long bump_cpu_sum = 0;
+unsigned int bump_cpu_max = 0;
+unsigned long bump_reads = 0;
+
+#if IR_MUX == IR_MUX_FDM
+// bump 载波幅度换算成等效放电时间：放电时间约和光强成反比，在标定位置和 bump_base 对上
+// line 载波左右两路之差给方向
+// 解调幅度是 |I, Q|，噪声不会平均成 0：没有信号的一路读到约 2 计数（64 轮窗口，见上面）。
+// 噪声按平方和叠进幅度，信号 50 时只多约 0.05 计数，偏的是弱的那一路：
+//   - line_bearing：leader 偏到一边、远侧那路没有光时读的是噪声底，比值到不了 ±1，
+//     比如 l = 0、r = 45 时是 0.91 左右；两路合计不到 FDM_LINE_MIN_AMP 就不用（噪声底合计约 4 ± 1.3）
+//   - bump 等效读数：跟随距离上幅度约 56，偏差不到 0.1%（零点几 us），标定的 bump_amp_base 也带着同样的偏差；
+//     没有 leader 时幅度停在噪声底（2.6 ± 1.3）而不是 0，换算出来大多在 2500us 以上，
+//     比 mapIRtoCS 的饱和点高得多，效果和超时一样
+float bump_amp_base = 0.0f;
+float line_bearing = 0.0f;    // (R - L) / (R + L)，右边亮为正
+#define FDM_BUMP_MIN_AMP  1.0f
+#define FDM_LINE_MIN_AMP  10.0f
+#define FDM_STEER_GAIN    0.3f
+// 方向比值 ±1 大约对应 ±0.5rad；只决定窗口之间自己转角的补偿比例，车没转时 steer 和直接用比值一样
+#define FDM_BEARING_RAD   0.5f
+
+// 方向是在解调窗口那一刻、相对当时的车头量的：用那一刻的位姿换成世界坐标里 leader 的方向，
+// 之后每拍按当前航向算偏差，窗口之间（约 45ms）车自己转了多少就补多少
+Pose_t bump_pose;             // 最近一个解调窗口时刻跟随车自己的位姿
+float leader_heading = 0.0f;  // 世界坐标，rad
+bool leader_heading_valid = false;
+#endif
+
+constexpr float KP_L = 0.04025f;
+constexpr float KI_L = 0.00005f;
+constexpr float KD_L = 0.0f;
+
+constexpr float KP_R = 0.07000f;
+constexpr float KI_R = 0.00005f;
+constexpr float KD_R = 0.0f;
+
+// 没有前馈表（EEPROM 里没扫过）时的老办法：常数前馈 + 右轮比例
 const float kF_L = 13.5f;
 const float kF_R = 13.0f;
+#define RIGHT_SCALE 0.978f
 const float PWM_MAX = 60.0f;
 
+// 轮速环：左右轮一次更新，dt 用调度器实测周期，只需要输出限幅，Q16.16 定点
+DualPID_c<Fix16, PID_CLAMP> wheel_pid;
+
+// 上电时按住按键：先扫 PWM-速度表，再做轮速环自整定（轮子架空或地面空旷处）
+#define TUNE_BIAS_PWM   8.0f     // 在死区（或 kF）基础上再加一点，保证轮子转起来
+#define TUNE_RELAY_PWM  6.0f
+#define TUNE_HYST_CS    15.0f
+#define TUNE_TIMEOUT_MS 10000UL
+
+RelayTune_c tuneL;
+RelayTune_c tuneR;
+
+// PWM-速度表前馈，自整定时先扫一遍
+#define FF_SETTLE_MS    300
+#define FF_AVG_MS       200
+
+WheelFF_c ffL;
+WheelFF_c ffR;
+bool ff_valid = false;
+
+void taskEstimate();
+void taskPID();
+void taskSense();
+void handleBump(unsigned long raw);
+#if IR_MUX == IR_MUX_FDM
+float averageBumpAmplitude(byte windows);
+float wrapAngle(float a);
+#endif
+void autoTuneWheels();
+void identifyFeedforward();
+void sampleSteadySpeed(unsigned long settle_ms, unsigned long avg_ms, float &avg_l, float &avg_r);
+
 unsigned long readBump(int pin) {
   pinMode(pin, OUTPUT);
   digitalWrite(pin, HIGH);
@@ -74,22 +190,11 @@ bool isJumpCloseAndShift(unsigned long last_raw_val, unsigned long raw) {
   return false;
 }
 
-float mapIRtoCS(unsigned long raw) {
-  const float V_MIN = 0.0f;
-  const float V_MAX = 250.0f;
-  const float C = 230.0f;
-  const float K = 20.0f;
-
-  if (raw <= 150) return 0.0f;
+// sigmoid：C = 230, K = 20, V_MAX = 250，编译期生成查找表
+typedef IrMap_c<230, 20, 250> IrMapCS;
 
-  float x = ((float)raw - C) / K;
-  float s = 1.0f / (1.0f + expf(-x));
-  float v = V_MIN + (V_MAX - V_MIN) * s;
-
-  if (v < 0.0f) v = 0.0f;
-  if (v > V_MAX) v = V_MAX;
-
-  return v;
+float mapIRtoCS(unsigned long raw) {
+  return IrMapCS::lookup(raw);
 }
 
 float mapIRtoCS_withSafety(unsigned long raw, unsigned long last_raw_val) {
@@ -102,20 +207,65 @@ void setup() {
   Serial.begin(115200);
 
   motors.initialise();
+#ifdef MOTORS_BENCHMARK
+  delay(2000);
+  motors.benchmark(1000);
+#endif
+#ifdef LINE_SENSORS_BENCHMARK
+  delay(2000);
+  line_sensors.benchmark(200);
+#endif
+#ifdef IRMAP_BENCHMARK
+  delay(2000);
+  IrMapCS::benchmark(1000);
+#endif
+#ifdef ENCODERS_BENCHMARK
+  delay(2000);
+  encoderBenchmark(1000);
+#endif
+#ifdef PID_BENCHMARK
+  delay(2000);
+  pidBenchmark(1000, KP_L, KI_L, KD_L, KP_R, KI_R, KD_R);
+#endif
   setupEncoder0();
   setupEncoder1();
+#ifdef ENCODERS_PIN_LOG
+  delay(2000);
+  encoderPinLog(ENC_PIN_LOG_N);
+#endif
+#ifdef KINEMATICS_BENCHMARK
+  delay(2000);
+  kin.benchmark(1000);
+#endif
 
-  pidL.initialise(KP_L, KI_L, KD_L);
-  pidR.initialise(KP_R, KI_R, KD_R);
+  wheel_pid.initialise(KP_L, KI_L, KD_L, KP_R, KI_R, KD_R);
 
   kin.initialise(0.0f, 0.0f, 0.0f);
 
   pinMode(BUMP_L, INPUT);
   pinMode(BUMP_R, INPUT);
+#if IR_MUX == IR_MUX_TDMA && BUMP_ASYNC
+  bump_timer.initialise();
+  ir_pll.initialise(TDMA_FRAME_MS * 1000L, TDMA_GUARD_MS * 1000L);
+#endif
 
   pinMode(BTN_PIN, INPUT_PULLUP);
   pinMode(BUZZER_PIN, OUTPUT);
 
+  if (digitalRead(BTN_PIN) == LOW) autoTuneWheels();
+
+  TunedGains_t gains;
+  if (loadTunedGains(gains)) {
+    wheel_pid.setGains(PID_L, gains.kp[0], gains.ki[0], gains.kd[0]);
+    wheel_pid.setGains(PID_R, gains.kp[1], gains.ki[1], gains.kd[1]);
+    Serial.println("GAINS:EEPROM");
+  } else {
+    Serial.println("GAINS:DEFAULT");
+  }
+
+  ff_valid = loadFeedforward(ffL, ffR);
+  Serial.println(ff_valid ? "FF:EEPROM" : "FF:DEFAULT");
+
   softBeep(40);
 
   while (digitalRead(BTN_PIN) == HIGH) handleBeep();
@@ -123,6 +273,25 @@ void setup() {
   bump_base = readBump(BUMP_L);
   Serial.print("BUMP_BASE:");
   Serial.println(bump_base);
+#ifdef DIST_BUMP_N
+  // 有标定表时顺便给出跟随距离（mm）和单次读数的置信半宽
+  byte base_band = 0;
+  Serial.print("BUMP_BASE_MM:");
+  Serial.print(bumpDistanceMm(bump_base, &base_band));
+  Serial.print(" +-");
+  Serial.println(base_band);
+#endif
+#if IR_MUX == IR_MUX_FDM
+  // 同一位置记下 bump 载波幅度；从这里起后台ADC一直在跑，pin 4 交给它
+  line_sensors.beginADC();
+  bump_amp_base = averageBumpAmplitude(4);
+  Serial.print("BUMP_AMP_BASE:");
+  Serial.println(bump_amp_base);
+#elif BUMP_ASYNC
+  Serial.print("BUMP_CAP:");
+  // 超过查表饱和点的读数速度需求都一样，上限不必更高
+  Serial.println(bump_timer.calibrateCap(bump_base, IrMapCS::RAW_MAX));
+#endif
   softBeep(40);
   while (digitalRead(BTN_PIN) == LOW) handleBeep();
 
@@ -141,61 +310,320 @@ void setup() {
   while (digitalRead(BTN_PIN) == HIGH) handleBeep();
   softBeep(40);
   t0 = millis();
+  tdma.begin(t0);
 
-  last_e0 = count_e0;
-  last_e1 = count_e1;
-  ts_est = millis();
-  ts_pid = millis();
+  EncoderSnapshot_t enc;
+  readEncoders(enc);
+  wsR.initialise(edges_e0, enc.e0, micros());
+  wsL.initialise(edges_e1, enc.e1, micros());
+  kin.initialise(0.0f, 0.0f, 0.0f);
+  pose_hist.clear();
+#ifdef ODOMETRY_LOG
+  odo_log.start(enc);
+#endif
 
   while (digitalRead(BTN_PIN) == LOW) handleBeep();
+
+  scheduler.addTask(taskEstimate, EST_PERIOD_MS, EST_PERIOD_MS, 0);
+  scheduler.addTask(taskPID, PID_PERIOD_MS, PID_PERIOD_MS / 2, 1);
+  scheduler.addTask(taskSense, SENSE_PERIOD_MS, SENSE_PERIOD_MS, 2);
+  scheduler.begin();
 }
 
-void loop() {
-  unsigned long now = millis();
-  handleBeep();
+void taskEstimate() {
+  EncoderSnapshot_t enc;
+  readEncoders(enc);
+  unsigned long now_us = micros();
+  spdR = wsR.update(edges_e0, enc.e0, now_us);
+  spdL = wsL.update(edges_e1, enc.e1, now_us);
+
+  kin.update(enc);
+  pose_hist.append(millis(), kin);
+#ifdef ODOMETRY_LOG
+  odo_log.update(enc);
+#endif
+}
 
-  if (now - ts_est >= 20) {
-    unsigned long dt = now - ts_est;
-    long e0 = count_e0;
-    long e1 = count_e1;
-    float dt_sec = (float)dt / 1000.0f;
-    if (dt_sec > 0.0f) {
-      spdR = (float)(e0 - last_e0) / dt_sec;
-      spdL = (float)(e1 - last_e1) / dt_sec;
-    }
-    last_e0 = e0;
-    last_e1 = e1;
-    ts_est = now;
+void taskPID() {
+  float dL = demand_cs + steer_cs;
+  float dR = demand_cs - steer_cs;
+  Fix16 demand[2] = { Fix16(dL), Fix16(dR) };
+  Fix16 meas[2] = { Fix16(spdL), Fix16(spdR) };
+  Fix16 u[2];
+  wheel_pid.update(demand, meas, scheduler.periodUs(), u);
+  float pwmL;
+  float pwmR;
+  if (ff_valid) {
+    pwmL = ffL.pwmFor(dL) + u[PID_L].toFloat();
+    pwmR = ffR.pwmFor(dR) + u[PID_R].toFloat();
+  } else {
+    pwmL = kF_L + u[PID_L].toFloat();
+    pwmR = kF_R + u[PID_R].toFloat();
   }
 
-  if (now - ts_pid >= 40) {
-    ts_pid = now;
-    float uL = pidL.update(demand_cs, spdL);
-    float uR = pidR.update(demand_cs, spdR);
-    float pwmL = kF_L + uL;
-    float pwmR = kF_R + uR;
+  if (pwmL < 0.0f) pwmL = 0.0f;
+  if (pwmR < 0.0f) pwmR = 0.0f;
+  if (pwmL > PWM_MAX) pwmL = PWM_MAX;
+  if (pwmR > PWM_MAX) pwmR = PWM_MAX;
+  if (!ff_valid) pwmR *= RIGHT_SCALE;
 
-    if (pwmL < 0.0f) pwmL = 0.0f;
-    if (pwmR < 0.0f) pwmR = 0.0f;
-    if (pwmL > PWM_MAX) pwmL = PWM_MAX;
-    if (pwmR > PWM_MAX) pwmR = PWM_MAX;
+  motors.setPWM(pwmL, pwmR);
+}
 
-    motors.setPWM(pwmL, pwmR);
+void taskSense() {
+#if IR_MUX == IR_MUX_FDM
+  // 每个解调窗口（约 45ms）用一次：bump 载波给距离，line 载波给方向，两个同时有
+  static unsigned long last_seq = 0;
+  unsigned long seq = line_sensors.latestLockIn();
+  if (seq != last_seq) {
+    last_seq = seq;
+    float amp = line_sensors.amplitude_b[LINE_ADC_BUMP_CH];
+    float raw = (amp > FDM_BUMP_MIN_AMP) ? (float)bump_base * bump_amp_base / amp : (float)BUMP_TIMEOUT_US;
+    if (raw > (float)BUMP_TIMEOUT_US) raw = (float)BUMP_TIMEOUT_US;
+    handleBump((unsigned long)raw);
+
+    float l = line_sensors.amplitude[0];
+    float r = line_sensors.amplitude[4];
+    line_bearing = (l + r > FDM_LINE_MIN_AMP) ? (r - l) / (r + l) : 0.0f;
+    // 取不到窗口时刻的位姿（比历史还早或者外推太远）就不更新方向，不拿现在的位姿凑
+    unsigned long ts = millis() - (micros() - line_sensors.lockin_t_us) / 1000;
+    if (l + r <= FDM_LINE_MIN_AMP) {
+      leader_heading_valid = false;
+    } else if (pose_hist.atTime(ts, bump_pose)) {
+      // 右边亮（比值为正）leader 在右边，航向角是逆时针为正
+      leader_heading = bump_pose.theta - FDM_BEARING_RAD * line_bearing;
+      leader_heading_valid = true;
+    }
+  }
+  if (leader_heading_valid) {
+    float err = wrapAngle(leader_heading - kin.theta);
+    steer_cs = -FDM_STEER_GAIN * demand_cs * err / FDM_BEARING_RAD;
+  } else {
+    steer_cs = 0.0f;
+  }
+#elif BUMP_ASYNC
+  // 每拍都在后台测一次（上一拍开始的结果这一拍取），锁相环需要两个半周期的读数
+  BumpSample_t bs;
+  if (bump_timer.read(bs)) {
+    bump_cpu_sum += bs.cpu_us;
+    if (bs.cpu_us > bump_cpu_max) bump_cpu_max = bs.cpu_us;
+    bump_reads++;
+    unsigned long raw = (bs.left_us + bs.right_us) / 2;
+    ir_pll.sample(raw, bs.t_us);
+
+    if (ir_pll.locked) {
+      // 锁定：bump 半周期中间部分的读数都用
+      if (ir_pll.inBumpWindow(bs.t_us)) handleBump(raw);
+    } else {
+      // 未锁定：退回按 t0 分时隙，每个 bump 时隙只用第一次读数
+      if (tdma.update(bs.t_ms) && tdma.slotType() == TDMA_SLOT_BUMP) handleBump(raw);
+    }
+  }
+  // 锁定以后只有 bump 窗口里开始的测量才用得上，别的只要粗节拍（给锁相环看高低就够了）
+  if (!bump_timer.busy()) bump_timer.start(!ir_pll.locked || ir_pll.inBumpWindow(micros()));
+#else
+  // 进入 bump 时隙的第一拍读一次
+  if (tdma.update(millis()) && tdma.slotType() == TDMA_SLOT_BUMP) {
+    unsigned long rawL = readBump(BUMP_L);
+    unsigned long rawR = readBump(BUMP_R);
+    handleBump((rawL + rawR) / 2);
   }
+#endif
+}
 
-  unsigned long t = (now - t0) % 200;
-  bool bump_window = (t < 100);
-  static bool last_window = false;
-
-  if (bump_window != last_window) {
-    last_window = bump_window;
-    if (bump_window) {
-      unsigned long rawL = readBump(BUMP_L);
-      unsigned long rawR = readBump(BUMP_R);
-      unsigned long raw = (rawL + rawR) / 2;
-      unsigned long prev_raw = last_raw;
-      last_raw = raw;
-      demand_cs = mapIRtoCS_withSafety(raw, prev_raw);
+// 一次bump读数：更新速度需求
+void handleBump(unsigned long raw) {
+  unsigned long prev_raw = last_raw;
+  last_raw = raw;
+  demand_cs = mapIRtoCS_withSafety(raw, prev_raw);
+}
+
+#if IR_MUX == IR_MUX_FDM
+// 回绕到 [-π, π)
+float wrapAngle(float a) {
+  while (a >= PI) a -= 2.0f * PI;
+  while (a < -PI) a += 2.0f * PI;
+  return a;
+}
+
+// 取 windows 个新的解调窗口，返回左 bump 上 bump 载波幅度的平均
+float averageBumpAmplitude(byte windows) {
+  float sum = 0.0f;
+  unsigned long last_seq = line_sensors.latestLockIn();
+  for (byte n = 0; n < windows; n++) {
+    unsigned long seq;
+    while ((seq = line_sensors.latestLockIn()) == last_seq) handleBeep();
+    last_seq = seq;
+    sum += line_sensors.amplitude_b[LINE_ADC_BUMP_CH];
+  }
+  return sum / windows;
+}
+#endif
+
+// 按 PID 周期采样轮速，前 settle_ms 不要，之后 avg_ms 取平均
+void sampleSteadySpeed(unsigned long settle_ms, unsigned long avg_ms, float &avg_l, float &avg_r) {
+  EncoderSnapshot_t enc;
+  float sum_l = 0.0f;
+  float sum_r = 0.0f;
+  int n = 0;
+  unsigned long t_start = millis();
+  unsigned long t_next = t_start;
+  while (millis() - t_start < settle_ms + avg_ms) {
+    if ((long)(millis() - t_next) < 0) continue;
+    t_next += PID_PERIOD_MS;
+    readEncoders(enc);
+    unsigned long now_us = micros();
+    spdR = wsR.update(edges_e0, enc.e0, now_us);
+    spdL = wsL.update(edges_e1, enc.e1, now_us);
+    if (millis() - t_start >= settle_ms) {
+      sum_l += spdL;
+      sum_r += spdR;
+      n++;
     }
   }
+  avg_l = n ? sum_l / n : 0.0f;
+  avg_r = n ? sum_r / n : 0.0f;
+}
+
+// PWM 从 0 往上扫，记录每一档的稳态速度
+void identifyFeedforward() {
+  for (byte i = 0; i < FF_POINTS; i++) {
+    float pwm = i * FF_PWM_STEP;
+    motors.setPWM(pwm, pwm);
+    float avg_l;
+    float avg_r;
+    sampleSteadySpeed(FF_SETTLE_MS, FF_AVG_MS, avg_l, avg_r);
+    ffL.cps[i] = (int16_t)avg_l;
+    ffR.cps[i] = (int16_t)avg_r;
+  }
+  motors.setPWM(0.0f, 0.0f);
+
+  ffL.makeMonotone();
+  ffR.makeMonotone();
+  ff_valid = ffL.valid && ffR.valid;
+  if (ff_valid) saveFeedforward(ffL, ffR);
+
+  Serial.println("PWM,CPS_L,CPS_R");
+  for (byte i = 0; i < FF_POINTS; i++) {
+    Serial.print(i * FF_PWM_STEP);
+    Serial.print(",");
+    Serial.print(ffL.cps[i]);
+    Serial.print(",");
+    Serial.println(ffR.cps[i]);
+  }
+  Serial.print("FF_DEADZONE:");
+  Serial.print(ffL.deadzonePWM());
+  Serial.print(",");
+  Serial.println(ffR.deadzonePWM());
+  delay(500);
+}
+
+void autoTuneWheels() {
+  softBeep(200);
+  while (digitalRead(BTN_PIN) == LOW) handleBeep();
+  delay(500);
+
+  EncoderSnapshot_t enc;
+  readEncoders(enc);
+  wsR.initialise(edges_e0, enc.e0, micros());
+  wsL.initialise(edges_e1, enc.e1, micros());
+
+  identifyFeedforward();
+
+  float bias_l = (ff_valid ? ffL.deadzonePWM() : kF_L) + TUNE_BIAS_PWM;
+  float bias_r = (ff_valid ? ffR.deadzonePWM() : kF_R) + TUNE_BIAS_PWM;
+  motors.setPWM(bias_l, bias_r);
+
+  // 先开环跑一段，稳定后的平均速度作为继电的 setpoint
+  float sp_l;
+  float sp_r;
+  sampleSteadySpeed(500, 1000, sp_l, sp_r);
+
+  tuneL.begin(sp_l, bias_l, TUNE_RELAY_PWM, TUNE_HYST_CS, millis());
+  tuneR.begin(sp_r, bias_r, TUNE_RELAY_PWM, TUNE_HYST_CS, millis());
+
+  unsigned long t_start = millis();
+  unsigned long t_next = t_start;
+  while (!(tuneL.done() && tuneR.done()) && millis() - t_start < TUNE_TIMEOUT_MS) {
+    if ((long)(millis() - t_next) < 0) continue;
+    t_next += PID_PERIOD_MS;
+    readEncoders(enc);
+    unsigned long now_ms = millis();
+    unsigned long now_us = micros();
+    spdR = wsR.update(edges_e0, enc.e0, now_us);
+    spdL = wsL.update(edges_e1, enc.e1, now_us);
+    motors.setPWM(tuneL.update(spdL, now_ms), tuneR.update(spdR, now_ms));
+  }
+  motors.setPWM(0.0f, 0.0f);
+
+  if (!(tuneL.done() && tuneR.done())) {
+    Serial.println("TUNE:FAIL");
+    softBeep(600);
+    return;
+  }
+
+  TunedGains_t gains;
+  tuneL.gains(gains.kp[0], gains.ki[0], gains.kd[0]);
+  tuneR.gains(gains.kp[1], gains.ki[1], gains.kd[1]);
+  saveTunedGains(gains);
+
+  Serial.println("Wheel,Setpoint,Ku,Tu_ms,Kp,Ki,Kd");
+  Serial.print("L,");
+  Serial.print(tuneL.setpoint);
+  Serial.print(",");
+  Serial.print(tuneL.ku, 5);
+  Serial.print(",");
+  Serial.print(tuneL.tu_ms);
+  Serial.print(",");
+  Serial.print(gains.kp[0], 5);
+  Serial.print(",");
+  Serial.print(gains.ki[0], 6);
+  Serial.print(",");
+  Serial.println(gains.kd[0], 5);
+  Serial.print("R,");
+  Serial.print(tuneR.setpoint);
+  Serial.print(",");
+  Serial.print(tuneR.ku, 5);
+  Serial.print(",");
+  Serial.print(tuneR.tu_ms);
+  Serial.print(",");
+  Serial.print(gains.kp[1], 5);
+  Serial.print(",");
+  Serial.print(gains.ki[1], 6);
+  Serial.print(",");
+  Serial.println(gains.kd[1], 5);
+  softBeep(40);
+}
+
+void printResults() {
+  scheduler.printStats();
+#if IR_MUX == IR_MUX_FDM
+  Serial.print("LINE_BEARING:");
+  Serial.println(line_bearing, 3);
+#elif BUMP_ASYNC
+  ir_pll.printStatus();
+  Serial.print("BUMP_CPU_US mean:");
+  Serial.print(bump_reads ? (float)bump_cpu_sum / bump_reads : 0.0f, 1);
+  Serial.print(" max:");
+  Serial.println(bump_cpu_max);
+#endif
+#ifdef ODOMETRY_LOG
+  EncoderSnapshot_t enc;
+  readEncoders(enc);
+  odo_log.dump(enc);
+#endif
+}
+
+void loop() {
+  handleBeep();
+
+  scheduler.run();
+
+  // 运行中按键：停车并输出调度统计
+  if (scheduler.running && digitalRead(BTN_PIN) == LOW) {
+    scheduler.stop();
+    motors.setPWM(0.0f, 0.0f);
+    printResults();
+    while (digitalRead(BTN_PIN) == LOW) handleBeep();
+  }
 }
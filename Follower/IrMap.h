@@ -0,0 +1,138 @@
+#ifndef _IRMAP_H
+#define _IRMAP_H
+
+#include <Arduino.h>
+
+// bump 读数（us）到速度需求（cs）的 sigmoid：v = V_MAX / ( 1 + exp( -( raw - C ) / K ) )，raw <= 150 时为 0
+// 表在编译期按 C / K / V_MAX 生成，放在 PROGMEM 里。运行时查表再线性插值，不调 expf()
+// 每 IRMAP_STEP_US 一个点，单位 1/64 cs，覆盖 150 .. C + 8K。再往后曲线已经到 V_MAX 的 99.97%，直接取最后一个点
+// 插值误差上限 STEP² / 8 * max|v''| ≈ 0.12 cs（K = 20, V_MAX = 250），量化再加 1/128 cs，
+// float 算出来的表个别点比真正的 exp 差 1/64 cs。check_irmap.py 在电脑上重算这张表，实测最大 0.13 cs
+// 只用 C++11 的 constexpr（单 return 的递归），avr-gcc 上 double 就是 float，exp 先缩小 2^8 倍再平方回去，精度够用
+
+#define IRMAP_MIN_RAW     150
+#define IRMAP_STEP_SHIFT  2
+#define IRMAP_STEP_US     ( 1 << IRMAP_STEP_SHIFT )
+#define IRMAP_FRAC_BITS   6
+#define IRMAP_TAIL_K      8
+
+// e^x：小参数用泰勒级数，再平方 8 次
+constexpr double irMapExpSeries( double x, double term, int i ) {
+  return i > 6 ? term : term + irMapExpSeries( x, term * x / i, i + 1 );
+}
+
+constexpr double irMapSquare( double v, int n ) {
+  return n == 0 ? v : irMapSquare( v * v, n - 1 );
+}
+
+constexpr double irMapExp( double x ) {
+  return irMapSquare( irMapExpSeries( x / 256.0, 1.0, 1 ), 8 );
+}
+
+constexpr uint16_t irMapEntry( int c, int k, int v_max, int i ) {
+  return (uint16_t)( v_max * (double)( 1 << IRMAP_FRAC_BITS )
+                     / ( 1.0 + irMapExp( -( IRMAP_MIN_RAW + i * IRMAP_STEP_US - c ) / (double)k ) ) + 0.5 );
+}
+
+// 0, 1, ..., N-1
+template <int... I> struct IrMapSeq {};
+template <int N, int... I> struct IrMapMakeSeq : IrMapMakeSeq < N - 1, N - 1, I... > {};
+template <int... I> struct IrMapMakeSeq<0, I...> {
+  typedef IrMapSeq<I...> type;
+};
+
+template <int C, int K, int V_MAX, typename S> struct IrMapTable;
+template <int C, int K, int V_MAX, int... I> struct IrMapTable<C, K, V_MAX, IrMapSeq<I...> > {
+  static const uint16_t data[ sizeof...( I ) ];
+};
+template <int C, int K, int V_MAX, int... I>
+const uint16_t IrMapTable<C, K, V_MAX, IrMapSeq<I...> >::data[ sizeof...( I ) ] PROGMEM = { irMapEntry( C, K, V_MAX, I )... };
+
+template <int C, int K, int V_MAX>
+class IrMap_c {
+  public:
+
+    static_assert( C > IRMAP_MIN_RAW && K > 0, "sigmoid centre must be above IRMAP_MIN_RAW" );
+    static_assert( V_MAX > 0 && V_MAX < ( 0x10000 >> IRMAP_FRAC_BITS ), "V_MAX does not fit the table" );
+
+    static constexpr int N = ( C + IRMAP_TAIL_K * K - IRMAP_MIN_RAW + IRMAP_STEP_US - 1 ) / IRMAP_STEP_US + 1;
+    // 读数到这里以后 lookup() 都返回最后一个点
+    static constexpr int RAW_MAX = IRMAP_MIN_RAW + ( N - 1 ) * IRMAP_STEP_US;
+
+    // 相邻两点之差的上限：sigmoid 最大斜率 V_MAX / 4K 乘一步，两端各有半个单位的舍入
+    // lookup() 里 ( b - a ) * f 在 AVR 上是 16 位的，要按有符号 int 留够余量
+    static constexpr long MAX_STEP = (long)V_MAX * ( 1 << IRMAP_FRAC_BITS ) * IRMAP_STEP_US / ( 4L * K ) + 1;
+    static_assert( MAX_STEP * ( IRMAP_STEP_US - 1 ) + IRMAP_STEP_US / 2 < 32768,
+                   "sigmoid too steep for the 16-bit interpolation in lookup()" );
+    typedef IrMapTable<C, K, V_MAX, typename IrMapMakeSeq<N>::type> Table;
+
+    static float lookup( unsigned long raw ) {
+      if ( raw <= IRMAP_MIN_RAW ) return 0.0f;
+      unsigned long d = raw - IRMAP_MIN_RAW;
+      unsigned long i = d >> IRMAP_STEP_SHIFT;
+      if ( i >= N - 1 ) return pgm_read_word( &Table::data[ N - 1 ] ) * ( 1.0f / ( 1 << IRMAP_FRAC_BITS ) );
+
+      const uint16_t *p = &Table::data[ i ];
+      uint16_t a = pgm_read_word( p );
+      uint16_t b = pgm_read_word( p + 1 );
+      byte f = d & ( IRMAP_STEP_US - 1 );
+      // 表单调递增，b - a 不会是负的；乘 f 以后不超过 MAX_STEP * 3，上面的 static_assert 保证放得进 16 位
+      uint16_t v = a + ( ( ( b - a ) * f + IRMAP_STEP_US / 2 ) >> IRMAP_STEP_SHIFT );
+      return v * ( 1.0f / ( 1 << IRMAP_FRAC_BITS ) );
+    }
+
+    // 原来的浮点公式（对照 / 测误差用）
+    static float exact( unsigned long raw ) {
+      if ( raw <= IRMAP_MIN_RAW ) return 0.0f;
+      float x = ( (float)raw - C ) / K;
+      return V_MAX / ( 1.0f + expf( -x ) );
+    }
+
+#ifdef IRMAP_BENCHMARK
+    // 查表和浮点公式各算 n 次（读数扫过 100..611us），输出每次的平均时间和 CPU 周期数
+    // 以及 0..1500us 内查表相对公式的最大误差
+    static void benchmark( unsigned int n ) {
+      volatile float sink = 0.0f;
+      unsigned long t;
+
+      t = micros();
+      for ( unsigned int i = 0; i < n; i++ ) sink = exact( 100 + ( i & 511 ) );
+      unsigned long t_exact = micros() - t;
+
+      t = micros();
+      for ( unsigned int i = 0; i < n; i++ ) sink = lookup( 100 + ( i & 511 ) );
+      unsigned long t_table = micros() - t;
+      (void)sink;
+
+      float max_err = 0.0f;
+      unsigned long at = 0;
+      for ( unsigned long raw = 0; raw <= 1500; raw++ ) {
+        float e = fabs( lookup( raw ) - exact( raw ) );
+        if ( e > max_err ) {
+          max_err = e;
+          at = raw;
+        }
+      }
+
+      Serial.println( "Path,us_per_call,cycles_per_call" );
+      Serial.print( "expf," );
+      Serial.print( (float)t_exact / n );
+      Serial.print( "," );
+      Serial.println( (float)t_exact * 16.0f / n );
+      Serial.print( "table," );
+      Serial.print( (float)t_table / n );
+      Serial.print( "," );
+      Serial.println( (float)t_table * 16.0f / n );
+
+      Serial.print( "TABLE_BYTES:" );
+      Serial.println( N * 2 );
+      Serial.print( "MAX_ERR_CS:" );
+      Serial.print( max_err, 4 );
+      Serial.print( " at raw:" );
+      Serial.println( at );
+    }
+#endif
+
+};
+
+#endif
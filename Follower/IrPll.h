@@ -0,0 +1,161 @@
+#ifndef _IRPLL_H
+#define _IRPLL_H
+
+#include <Arduino.h>
+
+// 跟随 leader 发射切换的软件锁相环
+// leader 每半个周期切换一次：bump 发射（前向，bump 读数变小）/ line 发射（bump 读数变大）
+// 这里只用 bump 读数判断当前是哪半个周期：跟踪读数的高低包络，取中间两条线做带滞环的判决，
+// 判决翻转就是一次边沿，边沿时间取翻转前后两个采样时刻的中点
+// 每个边沿和预测的边沿比较得到相位误差，比例修正相位、积分修正周期（都是移位，整数运算）
+// 连续 PLL_LOCK_EDGES 个边沿误差都小于保护带认为锁定（误差超过两倍保护带直接失锁）；
+// 有效采样窗取每半周期两端各去掉 2 倍保护带（失锁门限）后的中间部分：
+// 锁定期间相位最多偏到失锁门限，窗口只去掉一倍保护带的话，偏出去的那部分会把 line 时隙的读数当成 bump
+#define PLL_LOCK_EDGES     4
+#define PLL_KP_SHIFT       2        // 相位修正 1/4
+#define PLL_KI_SHIFT       4        // 周期修正 1/16
+#define PLL_MIN_CONTRAST   150      // 高低包络差小于这个（us）认为看不到 leader
+#define PLL_ENV_SHIFT      4        // 包络回落速度 1/16
+
+class IrPll_c {
+  public:
+
+    long nominal_us;
+    long guard_us;             // 每半周期两端各去掉的保护带
+    long period_us;            // 估计的 leader 周期
+    unsigned long edge_us;     // 预测的最近一次 bump 半周期开始时刻
+    unsigned long frames;      // 锁定后经过的整周期数
+    long phase_err_us;         // 最近一次边沿的相位误差
+    bool locked;
+    byte good_edges;
+    bool have_edge;
+
+    unsigned long lo;          // 读数的低/高包络
+    unsigned long hi;
+    int8_t state;              // 1 = bump 半周期，0 = line 半周期，-1 = 还不知道
+    unsigned long last_t_us;
+
+    IrPll_c() {
+    }
+
+    void initialise( long period, long guard ) {
+      nominal_us = period;
+      guard_us = guard;
+      period_us = period;
+      edge_us = 0;
+      frames = 0;
+      phase_err_us = 0;
+      locked = false;
+      good_edges = 0;
+      have_edge = false;
+      lo = 0xFFFFFFFFUL;
+      hi = 0;
+      state = -1;
+      last_t_us = 0;
+    }
+
+    // 每个 bump 读数（us）和它的测量时刻调用一次
+    void sample( unsigned long raw, unsigned long t_us ) {
+      // 包络：碰到新极值立刻跟上，否则慢慢往读数靠
+      if ( raw < lo ) lo = raw;
+      else lo += ( raw - lo ) >> PLL_ENV_SHIFT;
+      if ( raw > hi ) hi = raw;
+      else hi -= ( hi - raw ) >> PLL_ENV_SHIFT;
+
+      advance( t_us );
+
+      if ( hi - lo < PLL_MIN_CONTRAST ) {
+        state = -1;
+        locked = false;
+        good_edges = 0;
+        last_t_us = t_us;
+        return;
+      }
+
+      unsigned long third = ( hi - lo ) / 3;
+      int8_t s = state;
+      if ( raw < lo + third ) s = 1;
+      else if ( raw > hi - third ) s = 0;
+
+      if ( state >= 0 && s != state ) {
+        unsigned long t_edge = last_t_us + ( t_us - last_t_us ) / 2;
+        edge( t_edge, s == 1 );
+      }
+      state = s;
+      last_t_us = t_us;
+    }
+
+    void edge( unsigned long t_edge, bool bump_start ) {
+      if ( !have_edge ) {
+        // 第一次：直接对齐
+        edge_us = bump_start ? t_edge : t_edge - period_us / 2;
+        have_edge = true;
+        return;
+      }
+
+      advance( t_edge );
+      long predicted = bump_start ? 0 : period_us / 2;
+      long e = (long)( t_edge - edge_us ) - predicted;
+      if ( e > period_us / 2 ) e -= period_us;
+      if ( e < -period_us / 2 ) e += period_us;
+      phase_err_us = e;
+
+      edge_us += e >> PLL_KP_SHIFT;
+      period_us += e >> PLL_KI_SHIFT;
+      if ( period_us > nominal_us + nominal_us / 10 ) period_us = nominal_us + nominal_us / 10;
+      if ( period_us < nominal_us - nominal_us / 10 ) period_us = nominal_us - nominal_us / 10;
+
+      long ae = ( e < 0 ) ? -e : e;
+      if ( ae > 2 * guard_us ) {
+        locked = false;
+        good_edges = 0;
+      } else if ( ae < guard_us ) {
+        if ( good_edges < PLL_LOCK_EDGES ) good_edges++;
+        if ( good_edges >= PLL_LOCK_EDGES ) locked = true;
+      } else {
+        good_edges = 0;
+      }
+    }
+
+    // 让 edge_us 保持在 t_us 之前最近的一个周期起点
+    void advance( unsigned long t_us ) {
+      if ( !have_edge ) return;
+      while ( (long)( t_us - edge_us ) >= period_us ) {
+        edge_us += period_us;
+        if ( locked ) frames++;
+      }
+    }
+
+    // t_us 在当前周期里的相位（0 = bump 半周期开始）
+    long phaseUs( unsigned long t_us ) {
+      advance( t_us );
+      long p = (long)( t_us - edge_us );
+      if ( p < 0 ) p += period_us;
+      return p;
+    }
+
+    // 锁定且 t_us 落在 bump 半周期中间的有效部分
+    bool inBumpWindow( unsigned long t_us ) {
+      if ( !locked ) return false;
+      long half = period_us / 2;
+      long margin = 2 * guard_us;
+      long p = phaseUs( t_us );
+      return ( p >= margin && p < half - margin );
+    }
+
+    void printStatus() {
+      Serial.print( "PLL locked:" );
+      Serial.print( locked ? 1 : 0 );
+      Serial.print( " period_us:" );
+      Serial.print( period_us );
+      Serial.print( " phase_err_us:" );
+      Serial.print( phase_err_us );
+      Serial.print( " frames:" );
+      Serial.print( frames );
+      Serial.print( " contrast_us:" );
+      Serial.println( hi > lo ? hi - lo : 0 );
+    }
+
+};
+
+#endif
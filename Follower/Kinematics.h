@@ -3,20 +3,126 @@
 #define _KINEMATICS_H
 
 #include <math.h>
+#include <avr/pgmspace.h>
+#include "Encoders.h"
 
-extern volatile long count_e0;
-extern volatile long count_e1;
+// 1 = 定点里程计（Q16.16 位置 + 查表三角函数），0 = 原来的 float 版本
+#ifndef KINEMATICS_FIXED_POINT
+#define KINEMATICS_FIXED_POINT 0
+#endif
+
+// 积分方式
+// EULER:    用更新前的航向走直线（原来的做法）
+// MIDPOINT: 用本段中点航向 theta + dθ/2
+// ARC:      精确圆弧，弦长 = d * sin(dθ/2)/(dθ/2)，方向为中点航向
+#define KIN_EULER     0
+#define KIN_MIDPOINT  1
+#define KIN_ARC       2
+
+#ifndef KINEMATICS_INTEGRATION
+#define KINEMATICS_INTEGRATION KIN_EULER
+#endif
+
+// 轮径/轮距：如果草图目录里有 calibrate_odometry.py 生成的 RobotProfile.h 就用标定值
+#if __has_include("RobotProfile.h")
+#include "RobotProfile.h"
+#endif
+
+#ifndef ROBOT_WHEEL_RADIUS_L
+#define ROBOT_WHEEL_RADIUS_L 16.63
+#endif
+#ifndef ROBOT_WHEEL_RADIUS_R
+#define ROBOT_WHEEL_RADIUS_R 16.63
+#endif
+#ifndef ROBOT_WHEEL_SEP
+#define ROBOT_WHEEL_SEP 43.15
+#endif
 
 const float count_per_rev = 358.3;
-const float wheel_radius  = 16.63;
-const float wheel_sep     = 43.15;
+const float wheel_radius_l = ROBOT_WHEEL_RADIUS_L;   // e1
+const float wheel_radius_r = ROBOT_WHEEL_RADIUS_R;   // e0
+const float wheel_radius  = ( wheel_radius_l + wheel_radius_r ) / 2.0;
+const float wheel_sep     = ROBOT_WHEEL_SEP;
 
 const float mm_per_count  = ( 2.0 * wheel_radius * PI ) / count_per_rev;
+const float mm_per_count_l = ( 2.0 * wheel_radius_l * PI ) / count_per_rev;
+const float mm_per_count_r = ( 2.0 * wheel_radius_r * PI ) / count_per_rev;
+
+#if KINEMATICS_FIXED_POINT
+
+// 角度单位：2^24 = 一整圈
+#define KIN_ANGLE_ONE_REV  16777216L
+
+// 每个计数的距离（mm，Q16.16）
+const long mm_per_count_q16_l = (long)( mm_per_count_l * 65536.0 + 0.5 );
+const long mm_per_count_q16_r = (long)( mm_per_count_r * 65536.0 + 0.5 );
+// 每个计数对应的转角（2^24/圈）
+const long th_per_count_q24_l = (long)( mm_per_count_l / ( wheel_sep * 2.0 ) * ( KIN_ANGLE_ONE_REV / ( 2.0 * PI ) ) + 0.5 );
+const long th_per_count_q24_r = (long)( mm_per_count_r / ( wheel_sep * 2.0 ) * ( KIN_ANGLE_ONE_REV / ( 2.0 * PI ) ) + 0.5 );
+
+// sin 表，256 段一整圈，Q15，多一项方便插值
+const int16_t kin_sin_table[ 257 ] PROGMEM = {
+       0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+    6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+   12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+   18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+   23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+   27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+   30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+   32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+   32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+   32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+   30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+   27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+   23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+   18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+   12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+    6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+       0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+   -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+  -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+  -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+  -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+  -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+  -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+  -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+  -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+  -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+  -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+  -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+  -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+  -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+  -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+   -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+       0
+};
+
+// a: 2^24/圈，返回 Q15
+inline int16_t kinSin( long a ) {
+  byte idx  = (byte)( a >> 16 );
+  byte frac = (byte)( a >> 8 );
+  int16_t s0 = (int16_t)pgm_read_word( &kin_sin_table[ idx ] );
+  int16_t s1 = (int16_t)pgm_read_word( &kin_sin_table[ idx + 1 ] );
+  return s0 + (int16_t)( ( (long)( s1 - s0 ) * frac ) >> 8 );
+}
+
+inline int16_t kinCos( long a ) {
+  return kinSin( a + ( KIN_ANGLE_ONE_REV / 4 ) );
+}
+
+#endif
 
 class Kinematics_c {
   public:
 
     float x,y,theta;
+    float s;        // 累计行驶路程（mm，绝对值累加）
+
+#if KINEMATICS_FIXED_POINT
+    long x_q16;     // mm, Q16.16
+    long y_q16;
+    long th_q24;    // 2^24/圈，不回绕
+#endif
 
     long last_e1;
     long last_e0;
@@ -26,14 +132,73 @@ class Kinematics_c {
     } 
 
     void initialise( float start_x, float start_y, float start_th ) {
-      last_e0 = count_e0;
-      last_e1 = count_e1;
+      EncoderSnapshot_t enc;
+      readEncoders( enc );
+      last_e0 = enc.e0;
+      last_e1 = enc.e1;
       x = start_x;
       y = start_y;
       theta = start_th;
+      s = 0.0f;
+#if KINEMATICS_FIXED_POINT
+      x_q16 = (long)( start_x * 65536.0f );
+      y_q16 = (long)( start_y * 65536.0f );
+      th_q24 = (long)( start_th * ( KIN_ANGLE_ONE_REV / ( 2.0f * PI ) ) );
+#endif
     }
     
     void update( ) {
+        EncoderSnapshot_t enc;
+        readEncoders( enc );
+        update( enc );
+    }
+
+#if KINEMATICS_FIXED_POINT
+
+    void update( const EncoderSnapshot_t &enc ) {
+
+        long delta_e1 = enc.e1 - last_e1;
+        long delta_e0 = enc.e0 - last_e0;
+
+        last_e1 = enc.e1;
+        last_e0 = enc.e0;
+
+        // 平移量 mm Q16.16（左右平均）
+        long dist_q16 = ( delta_e0 * mm_per_count_q16_r + delta_e1 * mm_per_count_q16_l ) >> 1;
+        long dth_q24  = delta_e0 * th_per_count_q24_r - delta_e1 * th_per_count_q24_l;
+
+        // 降到 Q8 再乘 Q15，保证 32 位不溢出；右移都先加半个 LSB 四舍五入，
+        // 直接截断每拍都往小里偏，几百拍下来就是半毫米
+        long dist_q8 = ( dist_q16 + 128 ) >> 8;
+
+#if KINEMATICS_INTEGRATION == KIN_EULER
+        long head_q24 = th_q24;
+#else
+        long head_q24 = th_q24 + ( dth_q24 >> 1 );
+#endif
+
+#if KINEMATICS_INTEGRATION == KIN_ARC
+        // h = dθ/2 (rad, Q16)，804/65536 ≈ π/256
+        // sin(h)/h ≈ 1 - h²/6 + h⁴/120
+        long h_q16 = ( dth_q24 * 804L ) >> 16;
+        long h2_q16 = ( h_q16 * h_q16 ) >> 16;
+        long k_q16 = 65536L - h2_q16 / 6 + ( ( h2_q16 * h2_q16 ) >> 16 ) / 120;
+        dist_q8 = ( dist_q8 * k_q16 ) >> 16;
+#endif
+
+        x_q16 += ( dist_q8 * kinCos( head_q24 ) + 64 ) >> 7;
+        y_q16 += ( dist_q8 * kinSin( head_q24 ) + 64 ) >> 7;
+        th_q24 += dth_q24;
+        s += (float)labs( dist_q16 ) * ( 1.0f / 65536.0f );
+
+        x = (float)x_q16 * ( 1.0f / 65536.0f );
+        y = (float)y_q16 * ( 1.0f / 65536.0f );
+        theta = (float)th_q24 * ( 2.0f * PI / KIN_ANGLE_ONE_REV );
+    }
+
+#else
+
+    void update( const EncoderSnapshot_t &enc ) {
       
         long delta_e1;
         long delta_e0;
@@ -42,28 +207,69 @@ class Kinematics_c {
         float x_contribution;
         float th_contribution;
 
-        delta_e1 = count_e1 - last_e1;
-        delta_e0 = count_e0 - last_e0;
+        delta_e1 = enc.e1 - last_e1;
+        delta_e0 = enc.e0 - last_e0;
 
-        last_e1 = count_e1;
-        last_e0 = count_e0;
+        last_e1 = enc.e1;
+        last_e0 = enc.e0;
         
-        mean_delta = (float)delta_e1;
-        mean_delta += (float)delta_e0;
+        mean_delta = (float)delta_e1 * mm_per_count_l;
+        mean_delta += (float)delta_e0 * mm_per_count_r;
         mean_delta /= 2.0;
 
-        x_contribution = mean_delta * mm_per_count;
+        x_contribution = mean_delta;
 
-        th_contribution = (float)delta_e0;
-        th_contribution -= (float)delta_e1;
-        th_contribution *= mm_per_count;
+        th_contribution = (float)delta_e0 * mm_per_count_r;
+        th_contribution -= (float)delta_e1 * mm_per_count_l;
         th_contribution /= (wheel_sep *2.0);
 
-        x = x + x_contribution * cos( theta );
-        y = y + x_contribution * sin( theta );
+#if KINEMATICS_INTEGRATION == KIN_EULER
+        float heading = theta;
+#else
+        float heading = theta + th_contribution * 0.5f;
+#endif
+
+#if KINEMATICS_INTEGRATION == KIN_ARC
+        float h2 = th_contribution * th_contribution * 0.25f;
+        x_contribution *= 1.0f - h2 * ( 1.0f / 6.0f ) + h2 * h2 * ( 1.0f / 120.0f );
+#endif
+
+        x = x + x_contribution * cos( heading );
+        y = y + x_contribution * sin( heading );
         theta = theta + th_contribution;
+        s = s + fabs( x_contribution );
+
+    }
 
+#endif
+
+#ifdef KINEMATICS_BENCHMARK
+    // 当前编译的版本（KINEMATICS_FIXED_POINT / KINEMATICS_INTEGRATION）跑 n 次 update()，
+    // 输出每次的平均时间和 CPU 周期数；定点和 float 各烧一次对比。跑完位姿清零
+    void benchmark( unsigned int n ) {
+      EncoderSnapshot_t enc;
+      readEncoders( enc );
+      initialise( 0.0f, 0.0f, 0.0f );
+
+      unsigned long t = micros();
+      for ( unsigned int i = 0; i < n; i++ ) {
+        // 每拍几个计数、左右不等，一直在转弯
+        enc.e0 += 6;
+        enc.e1 += 4 + ( i & 1 );
+        update( enc );
+      }
+      unsigned long t_update = micros() - t;
+
+      Serial.println( "Path,us_per_call,cycles_per_call" );
+      Serial.print( KINEMATICS_FIXED_POINT ? "fixed_" : "float_" );
+      Serial.print( KINEMATICS_INTEGRATION == KIN_EULER ? "euler," : ( KINEMATICS_INTEGRATION == KIN_MIDPOINT ? "midpoint," : "arc," ) );
+      Serial.print( (float)t_update / n );
+      Serial.print( "," );
+      Serial.println( (float)t_update * 16.0f / n );
+
+      initialise( 0.0f, 0.0f, 0.0f );
     }
+#endif
 
 };
 
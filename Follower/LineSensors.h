@@ -8,6 +8,270 @@ const int sensor_pins[ NUM_SENSORS ] = { A11, A0, A2, A3, A4 };
 
 #define EMIT_PIN   11
 
+// 读法选择：readSensors() 按这个走 ADC 或 RC 放电计时
+#define LINE_READ_ADC      0
+#define LINE_READ_DIGITAL  1
+
+#ifndef LINE_READ_MODE
+#define LINE_READ_MODE LINE_READ_ADC
+#endif
+
+// RC 放电计时：A11 = PD6，A0/A2/A3/A4 = PF7/PF5/PF4/PF1
+// 五路一起充电，然后在一个循环里同时读 PIND/PINF，一次读完的时间约等于最慢那一路
+#define LINE_DIGITAL_TIMEOUT_US  5000
+#define LINE_D_MASK  ( 1 << PIND6 )
+#define LINE_F_MASK  ( ( 1 << PINF7 ) | ( 1 << PINF5 ) | ( 1 << PINF4 ) | ( 1 << PINF1 ) )
+
+const bool line_on_port_f[ NUM_SENSORS ] = { false, true, true, true, true };
+const byte line_port_bit[ NUM_SENSORS ] = { ( 1 << PIND6 ), ( 1 << PINF7 ), ( 1 << PINF5 ), ( 1 << PINF4 ), ( 1 << PINF1 ) };
+
+// 后台ADC：在ADC完成中断里依次转换5路，写进后备缓冲；一帧完成后交换前后缓冲、帧号加一
+// 使用者用 latestFrame() 拿最新的一整帧，不会触发转换，也不会拿到半新半旧的一帧
+// 分频同 analogRead（128，每路约104us），一帧约 0.52ms
+// 运行期间不要再调用 analogRead()
+// A11 = ADC9, A0 = ADC7, A2 = ADC5, A3 = ADC4, A4 = ADC1
+// LINE_ADC_BUMP_L 1：左 bump（pin 4 = PD4 = ADC8）排在第6路一起转换，只用来做锁相解调
+// （右 bump 在 PC6 上，没有ADC）；这时 pin 4 是带上拉的输入，不能再用放电计时读它
+#ifndef LINE_ADC_BUMP_L
+#define LINE_ADC_BUMP_L 0
+#endif
+
+#define LINE_ADC_CHANNELS  ( NUM_SENSORS + LINE_ADC_BUMP_L )
+#define LINE_ADC_BUMP_CH   NUM_SENSORS
+#define LINE_BUMP_L_PIN    4
+
+const byte line_adc_channel[ LINE_ADC_CHANNELS ] = { 9, 7, 5, 4, 1
+#if LINE_ADC_BUMP_L
+  , 8
+#endif
+};
+
+// 过采样/抽取（在 #include 之前定义）：
+//   LINE_ADC_OVERSAMPLE n  每路累加 4^n 个样本再右移 n 位，多出 n 位小数，帧率降为 1/4^n
+//                         n = 2 时约 120 帧/秒，噪声（白噪声部分）减半
+//   LINE_ADC_MEDIAN 1      累加前先对每路最近3个样本取中值，去掉单个尖峰
+#ifndef LINE_ADC_OVERSAMPLE
+#define LINE_ADC_OVERSAMPLE 0
+#endif
+
+#ifndef LINE_ADC_MEDIAN
+#define LINE_ADC_MEDIAN 0
+#endif
+
+#if LINE_ADC_OVERSAMPLE > 3
+#error "LINE_ADC_OVERSAMPLE > 3 overflows the 16-bit accumulator"
+#endif
+
+#define LINE_ADC_FRAC_BITS  LINE_ADC_OVERSAMPLE
+#define LINE_ADC_SWEEPS     ( 1 << ( 2 * LINE_ADC_OVERSAMPLE ) )
+
+// 锁相解调（LINE_ADC_LOCKIN 1）：leader 用 Carrier.h 在 EMIT_PIN 上发方波载波，
+// 每轮开始用 micros() 算载波相位，查表得 sin/cos 参考（±31，乘积放得进 int16），
+// 每路累加 v*cos、v*sin 和 v，2^LINE_LOCKIN_SHIFT 轮发布一次；发布时减掉均值的贡献，
+// 窗口里不是整数个周期也不会漏进直流。环境光、自己的发射管、慢变化都是直流/低频，解调后消掉
+// 每轮五路之间相差约 0.1ms，只是各路一个固定相位，取模值后没有影响
+// 输出 amplitude[]：载波开/关两态读数之差（ADC计数），和原来“背景 - 读数”同一个量级
+//
+// LINE_LOCKIN_BANK 2：再加一个 bump 载波的参考，每路同时解出两个幅度（频分，leader 用 beginFdm()）
+// amplitude[] 对应 line 载波，amplitude_b[] 对应 bump 载波；leader 两组发射管各只占一半的拍，
+// 所以这时的幅度是开/关之差的一半左右
+#ifndef LINE_ADC_LOCKIN
+#define LINE_ADC_LOCKIN 0
+#endif
+
+#ifndef LINE_LOCKIN_BANK
+#define LINE_LOCKIN_BANK 1
+#endif
+
+#if LINE_LOCKIN_BANK < 1 || LINE_LOCKIN_BANK > 2
+#error "LINE_LOCKIN_BANK must be 1 or 2"
+#endif
+
+// 和 leader Carrier.h 的 CARRIER_HALF_PERIOD_US / CARRIER_B_HALF_PERIOD_US 一样
+#ifndef LINE_LOCKIN_HALF_PERIOD_US
+#define LINE_LOCKIN_HALF_PERIOD_US    1152   // line，约 434Hz
+#endif
+
+#ifndef LINE_LOCKIN_B_HALF_PERIOD_US
+#define LINE_LOCKIN_B_HALF_PERIOD_US  768    // bump，约 651Hz
+#endif
+
+#ifndef LINE_LOCKIN_SHIFT
+#define LINE_LOCKIN_SHIFT  5                 // 32 轮，约 18ms
+#endif
+
+#if LINE_LOCKIN_SHIFT > 6
+#error "LINE_LOCKIN_SHIFT > 6 overflows the 16-bit sample sum"
+#endif
+
+#define LINE_LOCKIN_SWEEPS  ( 1 << LINE_LOCKIN_SHIFT )
+#define LINE_LOCKIN_REF     31
+// 每 us 的相位步进，一整圈 = 2^32
+#define LINE_LOCKIN_STEP    ( (uint32_t)( 0x100000000ULL / ( 2UL * LINE_LOCKIN_HALF_PERIOD_US ) ) )
+#define LINE_LOCKIN_STEP_B  ( (uint32_t)( 0x100000000ULL / ( 2UL * LINE_LOCKIN_B_HALF_PERIOD_US ) ) )
+
+const int8_t line_lockin_sin[ 32 ] PROGMEM = {
+  0, 6, 12, 17, 22, 26, 29, 30, 31, 30, 29, 26, 22, 17, 12, 6,
+  0, -6, -12, -17, -22, -26, -29, -30, -31, -30, -29, -26, -22, -17, -12, -6
+};
+
+struct LineADC_t {
+  volatile uint16_t buf[ 2 ][ LINE_ADC_CHANNELS ];   // 带 LINE_ADC_FRAC_BITS 位小数
+  volatile byte front;           // 已发布的那一半
+  volatile byte ch;              // 正在转换的通道序号
+  volatile unsigned long seq;    // 已发布的帧数
+  volatile bool running;
+
+  uint16_t acc[ LINE_ADC_CHANNELS ];
+  byte sweeps;
+  byte skip;                     // 中值窗口还没填满的轮数
+  uint16_t h1[ LINE_ADC_CHANNELS ];
+  uint16_t h2[ LINE_ADC_CHANNELS ];
+};
+
+LineADC_t line_adc;
+
+#if LINE_ADC_LOCKIN
+struct LineLockIn_t {
+  volatile long i[ 2 ][ LINE_LOCKIN_BANK ][ LINE_ADC_CHANNELS ];   // 已减掉均值的同相/正交分量
+  volatile long q[ 2 ][ LINE_LOCKIN_BANK ][ LINE_ADC_CHANNELS ];
+  volatile unsigned long t_us[ 2 ];          // 窗口中点
+  volatile byte front;
+  volatile unsigned long seq;
+
+  long acc_i[ LINE_LOCKIN_BANK ][ LINE_ADC_CHANNELS ];
+  long acc_q[ LINE_LOCKIN_BANK ][ LINE_ADC_CHANNELS ];
+  uint16_t acc_v[ LINE_ADC_CHANNELS ];
+  int acc_c[ LINE_LOCKIN_BANK ];             // 参考本身的和
+  int acc_s[ LINE_LOCKIN_BANK ];
+  int8_t c[ LINE_LOCKIN_BANK ];              // 这一轮的参考
+  int8_t s[ LINE_LOCKIN_BANK ];
+  byte sweeps;
+  unsigned long t_first;
+  unsigned long t_last;
+};
+
+LineLockIn_t line_lockin;
+
+inline void lineLockInReset() {
+  for ( byte r = 0; r < LINE_LOCKIN_BANK; r++ ) {
+    for ( byte k = 0; k < LINE_ADC_CHANNELS; k++ ) {
+      line_lockin.acc_i[ r ][ k ] = 0;
+      line_lockin.acc_q[ r ][ k ] = 0;
+    }
+    line_lockin.acc_c[ r ] = 0;
+    line_lockin.acc_s[ r ] = 0;
+  }
+  for ( byte k = 0; k < LINE_ADC_CHANNELS; k++ ) line_lockin.acc_v[ k ] = 0;
+  line_lockin.sweeps = 0;
+}
+
+inline void lineLockInRef( byte r, uint32_t phase ) {
+  byte idx = phase >> 27;
+  line_lockin.s[ r ] = (int8_t)pgm_read_byte( &line_lockin_sin[ idx ] );
+  line_lockin.c[ r ] = (int8_t)pgm_read_byte( &line_lockin_sin[ ( idx + 8 ) & 31 ] );
+  line_lockin.acc_c[ r ] += line_lockin.c[ r ];
+  line_lockin.acc_s[ r ] += line_lockin.s[ r ];
+}
+
+// 每轮第一路之前调用：按当前时刻取参考相位
+inline void lineLockInPhase() {
+  unsigned long t = micros();
+  if ( line_lockin.sweeps == 0 ) line_lockin.t_first = t;
+  line_lockin.t_last = t;
+  lineLockInRef( 0, (uint32_t)( t * LINE_LOCKIN_STEP ) );
+#if LINE_LOCKIN_BANK > 1
+  lineLockInRef( 1, (uint32_t)( t * LINE_LOCKIN_STEP_B ) );
+#endif
+}
+
+inline void lineLockInSample( byte i, uint16_t v ) {
+  for ( byte r = 0; r < LINE_LOCKIN_BANK; r++ ) {
+    line_lockin.acc_i[ r ][ i ] += (int16_t)v * line_lockin.c[ r ];
+    line_lockin.acc_q[ r ][ i ] += (int16_t)v * line_lockin.s[ r ];
+  }
+  line_lockin.acc_v[ i ] += v;
+}
+
+// 每轮最后一路之后调用
+inline void lineLockInSweepDone() {
+  if ( ++line_lockin.sweeps < LINE_LOCKIN_SWEEPS ) return;
+
+  // sum(v*c) - mean(v)*sum(c)
+  byte back = line_lockin.front ^ 1;
+  for ( byte r = 0; r < LINE_LOCKIN_BANK; r++ ) {
+    for ( byte k = 0; k < LINE_ADC_CHANNELS; k++ ) {
+      long v = line_lockin.acc_v[ k ];
+      line_lockin.i[ back ][ r ][ k ] = line_lockin.acc_i[ r ][ k ] - ( ( v * line_lockin.acc_c[ r ] ) >> LINE_LOCKIN_SHIFT );
+      line_lockin.q[ back ][ r ][ k ] = line_lockin.acc_q[ r ][ k ] - ( ( v * line_lockin.acc_s[ r ] ) >> LINE_LOCKIN_SHIFT );
+    }
+  }
+  line_lockin.t_us[ back ] = line_lockin.t_first + ( line_lockin.t_last - line_lockin.t_first ) / 2;
+  line_lockin.front = back;
+  line_lockin.seq++;
+  lineLockInReset();
+}
+#endif
+
+inline void lineADCSelect( byte i ) {
+  byte c = line_adc_channel[ i ];
+  if ( c & 0x08 ) ADCSRB |= ( 1 << MUX5 );
+  else ADCSRB &= ~( 1 << MUX5 );
+  ADMUX = ( 1 << REFS0 ) | ( c & 0x07 );
+}
+
+inline uint16_t median3( uint16_t a, uint16_t b, uint16_t c ) {
+  if ( a > b ) { uint16_t t = a; a = b; b = t; }
+  if ( b > c ) b = c;
+  return ( a > b ) ? a : b;
+}
+
+ISR( ADC_vect ) {
+  uint16_t v = ADC;
+  byte i = line_adc.ch;
+
+#if LINE_ADC_LOCKIN
+  // 用原始样本：中值会把方波削掉
+  if ( i == 0 ) lineLockInPhase();
+  lineLockInSample( i, v );
+#endif
+
+#if LINE_ADC_MEDIAN
+  uint16_t a = line_adc.h1[ i ];
+  line_adc.h1[ i ] = v;
+  v = median3( v, a, line_adc.h2[ i ] );
+  line_adc.h2[ i ] = a;
+#endif
+
+  line_adc.acc[ i ] += v;
+
+  if ( ++i >= LINE_ADC_CHANNELS ) {
+    i = 0;
+#if LINE_ADC_LOCKIN
+    lineLockInSweepDone();
+#endif
+    if ( line_adc.skip ) {
+      line_adc.skip--;
+      for ( byte k = 0; k < LINE_ADC_CHANNELS; k++ ) line_adc.acc[ k ] = 0;
+    } else if ( ++line_adc.sweeps >= LINE_ADC_SWEEPS ) {
+      // 4^n 个样本之和右移 n 位 = 平均值 * 2^n
+      byte back = line_adc.front ^ 1;
+      for ( byte k = 0; k < LINE_ADC_CHANNELS; k++ ) {
+        line_adc.buf[ back ][ k ] = line_adc.acc[ k ] >> LINE_ADC_OVERSAMPLE;
+        line_adc.acc[ k ] = 0;
+      }
+      line_adc.sweeps = 0;
+      line_adc.front = back;
+      line_adc.seq++;
+    }
+  }
+  line_adc.ch = i;
+
+  if ( !line_adc.running ) return;
+  lineADCSelect( i );
+  ADCSRA |= ( 1 << ADSC );
+}
+
 class LineSensors_c {
   
   public:
@@ -20,7 +284,20 @@ class LineSensors_c {
 
     float calibrated[ NUM_SENSORS ];
 
+    float amplitude[ LINE_ADC_CHANNELS ];    // 锁相解调出的载波幅度
+#if LINE_LOCKIN_BANK > 1
+    float amplitude_b[ LINE_ADC_CHANNELS ];  // bump 载波
+#endif
+    unsigned long lockin_t_us;               // 这个解调窗口的中点
+
     LineSensors_c() {
+      for (int i = 0; i < LINE_ADC_CHANNELS; i++) {
+        amplitude[i] = 0.0;
+#if LINE_LOCKIN_BANK > 1
+        amplitude_b[i] = 0.0;
+#endif
+      }
+      lockin_t_us = 0;
       for (int i = 0; i < NUM_SENSORS; i++) {
         readings[i] = 0.0;
         calibrated[i] = 0.0;
@@ -41,8 +318,149 @@ class LineSensors_c {
       
     }
 
+    void beginADC() {
+      initialiseForADC();
+
+      line_adc.front = 0;
+      line_adc.ch = 0;
+      line_adc.seq = 0;
+      line_adc.sweeps = 0;
+      line_adc.skip = LINE_ADC_MEDIAN ? 2 : 0;
+      for ( byte i = 0; i < LINE_ADC_CHANNELS; i++ ) line_adc.acc[ i ] = 0;
+#if LINE_ADC_BUMP_L
+      pinMode( LINE_BUMP_L_PIN, INPUT_PULLUP );
+#endif
+#if LINE_ADC_LOCKIN
+      line_lockin.front = 0;
+      line_lockin.seq = 0;
+      lineLockInReset();
+#endif
+      line_adc.running = true;
+
+      ADCSRA = ( 1 << ADEN ) | ( 1 << ADIE ) | ( 1 << ADPS2 ) | ( 1 << ADPS1 ) | ( 1 << ADPS0 );
+      lineADCSelect( 0 );
+      ADCSRA |= ( 1 << ADSC );
+    }
+
+    void stopADC() {
+      line_adc.running = false;
+      while ( ADCSRA & ( 1 << ADSC ) ) {}
+      ADCSRA &= ~( 1 << ADIE );
+    }
+
+    // 最新一帧的定点值（LINE_ADC_FRAC_BITS 位小数），返回帧号（0 表示还没有完整的一帧）
+    unsigned long latestFrameFixed( uint16_t v[ NUM_SENSORS ] ) {
+      byte sreg = SREG;
+      cli();
+      byte f = line_adc.front;
+      for ( byte i = 0; i < NUM_SENSORS; i++ ) v[ i ] = line_adc.buf[ f ][ i ];
+      unsigned long seq = line_adc.seq;
+      SREG = sreg;
+      return seq;
+    }
+
+    // 把最新一帧拷到 readings[]（单位仍是ADC计数，带小数），返回帧号
+    unsigned long latestFrame() {
+      uint16_t v[ NUM_SENSORS ];
+      unsigned long seq = latestFrameFixed( v );
+      for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+        readings[ i ] = (float)v[ i ] * ( 1.0f / ( 1 << LINE_ADC_FRAC_BITS ) );
+      }
+      return seq;
+    }
+
+#if LINE_ADC_LOCKIN
+    // 把最新一个解调窗口换算成 amplitude[]（和 amplitude_b[]），返回窗口序号（0 表示还没有）
+    // I、Q 是 v 和幅度 LINE_LOCKIN_REF 的正弦的相关，基波幅度 = 2|IQ| / (REF * N)，
+    // 方波开/关之差 = 基波幅度 * pi / 2
+    unsigned long latestLockIn() {
+      long li[ LINE_LOCKIN_BANK ][ LINE_ADC_CHANNELS ];
+      long lq[ LINE_LOCKIN_BANK ][ LINE_ADC_CHANNELS ];
+      byte sreg = SREG;
+      cli();
+      byte f = line_lockin.front;
+      for ( byte r = 0; r < LINE_LOCKIN_BANK; r++ ) {
+        for ( byte k = 0; k < LINE_ADC_CHANNELS; k++ ) {
+          li[ r ][ k ] = line_lockin.i[ f ][ r ][ k ];
+          lq[ r ][ k ] = line_lockin.q[ f ][ r ][ k ];
+        }
+      }
+      lockin_t_us = line_lockin.t_us[ f ];
+      unsigned long seq = line_lockin.seq;
+      SREG = sreg;
+
+      const float scale = PI / ( (float)LINE_LOCKIN_REF * LINE_LOCKIN_SWEEPS );
+      for ( byte r = 0; r < LINE_LOCKIN_BANK; r++ ) {
+        float *amp = amplitude;
+#if LINE_LOCKIN_BANK > 1
+        if ( r == 1 ) amp = amplitude_b;
+#endif
+        for ( byte k = 0; k < LINE_ADC_CHANNELS; k++ ) {
+          float fi = (float)li[ r ][ k ];
+          float fq = (float)lq[ r ][ k ];
+          amp[ k ] = sqrt( fi * fi + fq * fq ) * scale;
+        }
+      }
+      return seq;
+    }
+#endif
+
+    // 按 Welford 累计的均值/平方和输出每路噪声，返回最大的标准差
+    float printNoise( const float mean[ NUM_SENSORS ], const float m2[ NUM_SENSORS ], unsigned int n ) {
+      float worst = 0.0f;
+      Serial.println( "Sensor,Mean,StdDev,SNR_dB" );
+      for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+        float sd = ( n > 1 ) ? sqrt( m2[ i ] / ( n - 1 ) ) : 0.0f;
+        if ( sd > worst ) worst = sd;
+        Serial.print( i );
+        Serial.print( "," );
+        Serial.print( mean[ i ], 2 );
+        Serial.print( "," );
+        Serial.print( sd, 3 );
+        Serial.print( "," );
+        if ( sd > 0.0f ) Serial.println( 20.0f * log10( mean[ i ] / sd ), 1 );
+        else Serial.println( "inf" );
+      }
+      return worst;
+    }
+
+    // 静止时连续取 frames 个新帧，输出每路的均值、标准差和 SNR（均值/标准差，dB）
+    // 返回值是各路标准差里最大的，单位ADC计数，可以拿来定死区
+    float reportSNR( unsigned int frames ) {
+      float mean[ NUM_SENSORS ];
+      float m2[ NUM_SENSORS ];
+      for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+        mean[ i ] = 0.0f;
+        m2[ i ] = 0.0f;
+      }
+
+      unsigned long last_seq = latestFrame();
+      for ( unsigned int n = 1; n <= frames; n++ ) {
+        unsigned long seq;
+        while ( ( seq = latestFrame() ) == last_seq ) {}
+        last_seq = seq;
+        for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+          float d = readings[ i ] - mean[ i ];
+          mean[ i ] += d / n;
+          m2[ i ] += d * ( readings[ i ] - mean[ i ] );
+        }
+      }
+
+      Serial.print( "Oversample 4^" );
+      Serial.print( LINE_ADC_OVERSAMPLE );
+      Serial.print( ", median " );
+      Serial.println( LINE_ADC_MEDIAN ? "on" : "off" );
+      return printNoise( mean, m2, frames );
+    }
+
+    // 后台ADC在跑时直接取最新一帧，否则阻塞读5路
     void readSensorsADC() {
 
+      if ( line_adc.running ) {
+        latestFrame();
+        return;
+      }
+
       initialiseForADC();
 
       for( int sensor = 0; sensor < NUM_SENSORS; sensor++ ) {
@@ -72,9 +490,94 @@ class LineSensors_c {
 
     }
 
+    // readings[] 为放电时间（us），和 ADC 一样越暗越大；超时的记为 LINE_DIGITAL_TIMEOUT_US
+    // 会把传感器引脚改成输出，后台ADC在跑时不要用
     void readSensorsDigital() {
+
+      initialiseForDigital();
+
+      // 一起充电
+      PORTD |= LINE_D_MASK;
+      PORTF |= LINE_F_MASK;
+      DDRD |= LINE_D_MASK;
+      DDRF |= LINE_F_MASK;
+      delayMicroseconds( 10 );
+
+      // 一起切成输入（不带上拉）开始放电
+      DDRD &= ~LINE_D_MASK;
+      DDRF &= ~LINE_F_MASK;
+      PORTD &= ~LINE_D_MASK;
+      PORTF &= ~LINE_F_MASK;
+      unsigned long t_start = micros();
+
+      byte pend_d = LINE_D_MASK;
+      byte pend_f = LINE_F_MASK;
+      unsigned long elapsed = 0;
+
+      while ( ( pend_d | pend_f ) && elapsed < LINE_DIGITAL_TIMEOUT_US ) {
+        byte fell_d = pend_d & ~PIND;
+        byte fell_f = pend_f & ~PINF;
+        elapsed = micros() - t_start;
+
+        if ( fell_d | fell_f ) {
+          for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+            byte fell = line_on_port_f[ i ] ? fell_f : fell_d;
+            if ( fell & line_port_bit[ i ] ) readings[ i ] = (float)elapsed;
+          }
+          pend_d &= ~fell_d;
+          pend_f &= ~fell_f;
+        }
+      }
+
+      for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+        byte pend = line_on_port_f[ i ] ? pend_f : pend_d;
+        if ( pend & line_port_bit[ i ] ) readings[ i ] = (float)LINE_DIGITAL_TIMEOUT_US;
+      }
+
+    }
+
+    void readSensors() {
+#if LINE_READ_MODE == LINE_READ_DIGITAL
+      readSensorsDigital();
+#else
+      readSensorsADC();
+#endif
     }
 
+#ifdef LINE_SENSORS_BENCHMARK
+    // 两种读法各读 n 次：每次读完整一排的平均耗时，以及每路读数的均值/标准差
+    // 噪声在各自的单位里（ADC计数 / us），看 SNR 列比较
+    void benchmark( unsigned int n ) {
+      for ( byte mode = 0; mode < 2; mode++ ) {
+        float mean[ NUM_SENSORS ];
+        float m2[ NUM_SENSORS ];
+        for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+          mean[ i ] = 0.0f;
+          m2[ i ] = 0.0f;
+        }
+
+        unsigned long t_total = 0;
+        for ( unsigned int k = 1; k <= n; k++ ) {
+          unsigned long t = micros();
+          if ( mode == LINE_READ_DIGITAL ) readSensorsDigital();
+          else readSensorsADC();
+          t_total += micros() - t;
+
+          for ( byte i = 0; i < NUM_SENSORS; i++ ) {
+            float d = readings[ i ] - mean[ i ];
+            mean[ i ] += d / k;
+            m2[ i ] += d * ( readings[ i ] - mean[ i ] );
+          }
+        }
+
+        Serial.print( mode == LINE_READ_DIGITAL ? "DIGITAL" : "ADC" );
+        Serial.print( " read_us:" );
+        Serial.println( (float)t_total / n );
+        printNoise( mean, m2, n );
+      }
+    }
+#endif
+
     bool onLine( float threshold = 0.6 ) {
       calcCalibratedADC();
       for (int i = 0; i < NUM_SENSORS; i++) {
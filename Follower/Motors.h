@@ -1,25 +1,52 @@
-
 #ifndef _MOTORS_H
 #define _MOTORS_H
 
+// 直接写寄存器的电机驱动
+// L_PWM 10 = OC1B (PB6), R_PWM 9 = OC1A (PB5), L_DIR 16 = PB2, R_DIR 15 = PB1
+// setPWM() 的输入仍然是 0..255 的 PWM，内部按 TOP 换算成比较值，小数部分不丢
+// 方向引脚只在符号变化时才写
+//
+// Timer1 模式（16MHz 下 10 位和超声波频率不能同时满足，二选一）：
+//   MOTORS_PWM_ARDUINO  Arduino 默认，8位相位修正，约 490Hz，TOP 255
+//   MOTORS_PWM_10BIT    10位相位修正，ICR1 = 1023，约 7.8kHz，占空比步长 0.1%
+//   MOTORS_PWM_20K      相位修正，ICR1 = 400，20kHz 听不见，步长 0.25%（约8.6位）
+// kF 附近（PWM 13 左右）8位时一步就是 7%，10位/20k 时可以按 0.25/0.64 个原PWM单位调
+
 #define L_PWM 10
 #define L_DIR 16
 #define R_PWM 9
 #define R_DIR 15
 
-#define L_FWD LOW
-#define L_REV HIGH
-#define R_FWD LOW
-#define R_REV HIGH
-
-#define RIGHT_SCALE 0.978f
+#define L_DIR_BIT PORTB2
+#define R_DIR_BIT PORTB1
 
 #define MAX_PWM 180.0
 
+#define MOTORS_PWM_ARDUINO  0
+#define MOTORS_PWM_10BIT    1
+#define MOTORS_PWM_20K      2
+
+#ifndef MOTORS_PWM_MODE
+#define MOTORS_PWM_MODE MOTORS_PWM_ARDUINO
+#endif
+
+#if MOTORS_PWM_MODE == MOTORS_PWM_10BIT
+#define MOTORS_PWM_TOP 1023
+#elif MOTORS_PWM_MODE == MOTORS_PWM_20K
+#define MOTORS_PWM_TOP 400
+#else
+#define MOTORS_PWM_TOP 255
+#endif
+
+#define MOTORS_PWM_SCALE ( (float)MOTORS_PWM_TOP / 255.0f )
+
 class Motors_c {
 
   public:
 
+    bool left_rev;
+    bool right_rev;
+
     Motors_c() {
     }
 
@@ -30,46 +57,119 @@ class Motors_c {
       pinMode( R_PWM , OUTPUT );
       pinMode( R_DIR , OUTPUT );
 
-      digitalWrite( L_DIR, L_FWD );
-      digitalWrite( R_DIR, R_FWD );
-
-      analogWrite( L_PWM , 0 );
-      analogWrite( R_PWM , 0 );
+      // 正转 = LOW
+      PORTB &= ~( ( 1 << L_DIR_BIT ) | ( 1 << R_DIR_BIT ) );
+      left_rev = false;
+      right_rev = false;
+
+      OCR1A = 0;
+      OCR1B = 0;
+
+#if MOTORS_PWM_MODE == MOTORS_PWM_ARDUINO
+      // 定时器配置保持 Arduino 的，只把两个比较输出接上（analogWrite 也是这么做的）
+      TCCR1A |= ( 1 << COM1A1 ) | ( 1 << COM1B1 );
+#else
+      // 模式10：相位修正 PWM，TOP = ICR1，不分频
+      TCCR1B = 0;
+      TCCR1A = ( 1 << COM1A1 ) | ( 1 << COM1B1 ) | ( 1 << WGM11 );
+      ICR1 = MOTORS_PWM_TOP;
+      TCNT1 = 0;
+      TCCR1B = ( 1 << WGM13 ) | ( 1 << CS10 );
+#endif
 
     }
 
     void setPWM( float left_pwr, float right_pwr ) {
 
-      if ( left_pwr < 0 ) {
-        digitalWrite( L_DIR, L_REV );
-      } else {
-        digitalWrite( L_DIR, L_FWD );
+      bool l_rev = ( left_pwr < 0 );
+      if ( l_rev != left_rev ) {
+        if ( l_rev ) PORTB |= ( 1 << L_DIR_BIT );
+        else PORTB &= ~( 1 << L_DIR_BIT );
+        left_rev = l_rev;
       }
 
-      if ( right_pwr < 0 ) {
-        digitalWrite( R_DIR, R_REV );
-      } else {
-        digitalWrite( R_DIR, R_FWD );
+      bool r_rev = ( right_pwr < 0 );
+      if ( r_rev != right_rev ) {
+        if ( r_rev ) PORTB |= ( 1 << R_DIR_BIT );
+        else PORTB &= ~( 1 << R_DIR_BIT );
+        right_rev = r_rev;
       }
 
-      if ( left_pwr < 0 ) left_pwr = -left_pwr;
-      if ( left_pwr > 255.0 ) left_pwr = 255.0;
+      if ( l_rev ) left_pwr = -left_pwr;
       if ( left_pwr > MAX_PWM ) left_pwr = MAX_PWM;
-      int left_pwm_val = (int)left_pwr;
 
-      if ( right_pwr < 0 ) right_pwr = -right_pwr;
-      right_pwr = right_pwr * RIGHT_SCALE;
-      if ( right_pwr > 255.0 ) right_pwr = 255.0;
+      if ( r_rev ) right_pwr = -right_pwr;
       if ( right_pwr > MAX_PWM ) right_pwr = MAX_PWM;
-      int right_pwm_val = (int)right_pwr;
 
-      analogWrite( L_PWM, left_pwm_val );
-      analogWrite( R_PWM, right_pwm_val );
+      // 和原来 (int) 一样截断
+      OCR1B = (uint16_t)( left_pwr * MOTORS_PWM_SCALE );
+      OCR1A = (uint16_t)( right_pwr * MOTORS_PWM_SCALE );
 
       return;
 
     }
 
+#ifdef MOTORS_BENCHMARK
+    // 对比老的 digitalWrite/analogWrite 写法和这里的寄存器写法，每种调用 n 次
+    // 输出每次调用的平均时间和对应的 CPU 周期数，以及当前模式的分辨率
+    void benchmark( unsigned int n ) {
+      unsigned long t;
+      float p = 13.5f;
+
+      t = micros();
+      for ( unsigned int i = 0; i < n; i++ ) {
+        float l = ( i & 1 ) ? p : -p;
+        digitalWrite( L_DIR, l < 0 ? HIGH : LOW );
+        digitalWrite( R_DIR, l < 0 ? HIGH : LOW );
+        if ( l < 0 ) l = -l;
+        if ( l > 255.0 ) l = 255.0;
+        if ( l > MAX_PWM ) l = MAX_PWM;
+        analogWrite( L_PWM, (int)l );
+        analogWrite( R_PWM, (int)l );
+      }
+      unsigned long t_old = micros() - t;
+
+      // analogWrite 会改 TCCR1A，重新配置
+      initialise();
+
+      t = micros();
+      for ( unsigned int i = 0; i < n; i++ ) {
+        setPWM( p, p );
+      }
+      unsigned long t_same = micros() - t;
+
+      t = micros();
+      for ( unsigned int i = 0; i < n; i++ ) {
+        float l = ( i & 1 ) ? p : -p;
+        setPWM( l, l );
+      }
+      unsigned long t_flip = micros() - t;
+
+      setPWM( 0.0f, 0.0f );
+
+      Serial.println( "Path,us_per_call,cycles_per_call" );
+      Serial.print( "arduino," );
+      Serial.print( (float)t_old / n );
+      Serial.print( "," );
+      Serial.println( (float)t_old * 16.0f / n );
+      Serial.print( "register_same_dir," );
+      Serial.print( (float)t_same / n );
+      Serial.print( "," );
+      Serial.println( (float)t_same * 16.0f / n );
+      Serial.print( "register_dir_flip," );
+      Serial.print( (float)t_flip / n );
+      Serial.print( "," );
+      Serial.println( (float)t_flip * 16.0f / n );
+
+      Serial.print( "PWM_TOP:" );
+      Serial.println( MOTORS_PWM_TOP );
+      Serial.print( "STEP_IN_PWM_UNITS:" );
+      Serial.println( 1.0f / MOTORS_PWM_SCALE, 4 );
+      Serial.print( "DUTY_STEP_PERCENT:" );
+      Serial.println( 100.0f / MOTORS_PWM_TOP, 4 );
+    }
+#endif
+
 };
 
 #endif
@@ -0,0 +1,86 @@
+#ifndef _ODOMETRYLOG_H
+#define _ODOMETRYLOG_H
+
+#include <Arduino.h>
+#include "Encoders.h"
+
+// 标定用的原始编码器记录（Follower.ino 打开 ODOMETRY_LOG）
+// 跑车时每隔 ODOLOG_EVERY 次 taskEstimate 记一行两轮的计数增量（int16），
+// 停车后打印成 calibrate_odometry.py 要的累计计数 CSV：
+//   e0,e1
+//   <起点 e0>,<起点 e1>
+//   ...
+// e0 右轮、e1 左轮。串口监视器的输出直接存成文件就行（时间戳、前后的其他输出脚本会跳过）
+//
+// 150 行 600 字节，20ms × 5 = 100ms 一行大约能记 15 秒；记满以后不再记，终点位姿要在记满之前量
+
+#ifndef ODOLOG_CAPACITY
+#define ODOLOG_CAPACITY 150
+#endif
+
+#ifndef ODOLOG_EVERY
+#define ODOLOG_EVERY 5
+#endif
+
+class OdometryLog_c {
+  public:
+
+    int16_t d0[ ODOLOG_CAPACITY ];
+    int16_t d1[ ODOLOG_CAPACITY ];
+    long start_e0, start_e1;
+    long last_e0, last_e1;
+    uint16_t n;
+    byte tick;
+
+    OdometryLog_c() {
+      start( EncoderSnapshot_t() );
+    }
+
+    void start( const EncoderSnapshot_t &enc ) {
+      start_e0 = last_e0 = enc.e0;
+      start_e1 = last_e1 = enc.e1;
+      n = 0;
+      tick = 0;
+    }
+
+    bool full() {
+      return n >= ODOLOG_CAPACITY;
+    }
+
+    void update( const EncoderSnapshot_t &enc ) {
+      if ( full() || ++tick < ODOLOG_EVERY ) return;
+      tick = 0;
+      d0[ n ] = (int16_t)( enc.e0 - last_e0 );
+      d1[ n ] = (int16_t)( enc.e1 - last_e1 );
+      last_e0 = enc.e0;
+      last_e1 = enc.e1;
+      n++;
+    }
+
+    // enc：停车时的计数，没记满就当最后一行（上一行之后不足 ODOLOG_EVERY 拍的那一段）
+    void dump( const EncoderSnapshot_t &enc ) {
+      if ( full() ) Serial.println( "ODOLOG_FULL" );
+      Serial.println( "e0,e1" );
+      long e0 = start_e0;
+      long e1 = start_e1;
+      Serial.print( e0 );
+      Serial.print( "," );
+      Serial.println( e1 );
+      for ( uint16_t k = 0; k < n; k++ ) {
+        e0 += d0[ k ];
+        e1 += d1[ k ];
+        Serial.print( e0 );
+        Serial.print( "," );
+        Serial.println( e1 );
+      }
+      if ( !full() && ( enc.e0 != e0 || enc.e1 != e1 ) ) {
+        Serial.print( enc.e0 );
+        Serial.print( "," );
+        Serial.println( enc.e1 );
+      }
+      Serial.println( "ODOLOG_END" );
+    }
+
+};
+
+#endif
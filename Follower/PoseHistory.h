@@ -0,0 +1,163 @@
+#ifndef _POSEHISTORY_H
+#define _POSEHISTORY_H
+
+#include <Arduino.h>
+#include "Kinematics.h"
+
+// 带时间戳的位姿历史（环形缓冲，定长）
+// 每条记录 10 字节，全部用 16 位整数：
+//   t   : millis() 低 16 位（只比较相对最新一条的差值，65 秒内不会混淆）
+//   x,y : 0.5 mm，±16 m
+//   th  : 65536 = 一整圈，自然回绕
+//   s   : 累计路程 0.25 mm，同样只比较差值（16 m 内有效）
+// append() O(1)；atTime()/atDistance() 二分查找后线性插值，atTime() 可以往后外推一小段
+
+#define POSE_HISTORY_LEN 32
+
+// 比最新一条还新的时刻：按最后两条的速度外推，最多这么多 ms，再往后 atTime() 返回 false
+#define POSE_EXTRAP_MS   40
+
+#define POSE_XY_SCALE   2.0f                    // 1 mm = 2 单位
+#define POSE_S_SCALE    4.0f                    // 1 mm = 4 单位
+#define POSE_TH_SCALE   ( 65536.0f / ( 2.0f * PI ) )
+
+struct PoseRecord_t {
+  uint16_t t;
+  int16_t x;
+  int16_t y;
+  int16_t th;
+  uint16_t s;
+};
+
+struct Pose_t {
+  float x;
+  float y;
+  float theta;    // 回绕到 [-π, π)
+  float s;        // 与 Kinematics_c::s 同一基准
+};
+
+class PoseHistory_c {
+  public:
+
+    PoseRecord_t rec[ POSE_HISTORY_LEN ];
+    byte head;      // 下一条写入的位置
+    byte count;
+
+    // s 只存低 16 位，这里记住最新一条的完整值用来还原
+    float newest_s;
+
+    PoseHistory_c() {
+      clear();
+    }
+
+    void clear() {
+      head = 0;
+      count = 0;
+      newest_s = 0.0f;
+    }
+
+    void append( unsigned long t_ms, float x, float y, float theta, float s ) {
+      PoseRecord_t &r = rec[ head ];
+      r.t  = (uint16_t)t_ms;
+      r.x  = (int16_t)lroundf( x * POSE_XY_SCALE );
+      r.y  = (int16_t)lroundf( y * POSE_XY_SCALE );
+      r.th = (int16_t)(long)lroundf( theta * POSE_TH_SCALE );
+      r.s  = (uint16_t)(long)lroundf( s * POSE_S_SCALE );
+      newest_s = s;
+      head = ( head + 1 ) % POSE_HISTORY_LEN;
+      if ( count < POSE_HISTORY_LEN ) count++;
+    }
+
+    void append( unsigned long t_ms, const Kinematics_c &kin ) {
+      append( t_ms, kin.x, kin.y, kin.theta, kin.s );
+    }
+
+    // 按时间插值；晚于最新一条 POSE_EXTRAP_MS 以内时外推
+    // t_ms 早于最老一条、或者更晚（外推太远 / 只有一条记录没法外推）时返回 false
+    bool atTime( unsigned long t_ms, Pose_t &out ) {
+      if ( count == 0 ) return false;
+      uint16_t t_new = at( count - 1 ).t;
+      int16_t ahead = (int16_t)( (uint16_t)t_ms - t_new );
+      if ( ahead > 0 ) {
+        if ( ahead > POSE_EXTRAP_MS || count < 2 ) return false;
+        const PoseRecord_t &a = at( count - 2 );
+        const PoseRecord_t &b = at( count - 1 );
+        uint16_t span = b.t - a.t;
+        if ( span == 0 ) return false;
+        decode( a, b, (float)(uint16_t)( (uint16_t)t_ms - a.t ) / (float)span, out );
+        return true;
+      }
+      uint16_t age = t_new - (uint16_t)t_ms;
+      if ( age > (uint16_t)( t_new - at( 0 ).t ) ) return false;
+
+      // 找到第一个 age(i) <= age 的 i（age 随 i 增大而减小）
+      byte lo = 0;
+      byte hi = count - 1;
+      while ( lo < hi ) {
+        byte mid = ( lo + hi ) / 2;
+        if ( (uint16_t)( t_new - at( mid ).t ) <= age ) hi = mid;
+        else lo = mid + 1;
+      }
+      if ( lo == 0 ) {
+        decode( at( 0 ), at( 0 ), 0.0f, out );
+        return true;
+      }
+      const PoseRecord_t &a = at( lo - 1 );
+      const PoseRecord_t &b = at( lo );
+      uint16_t span = b.t - a.t;
+      float f = ( span == 0 ) ? 1.0f : (float)(uint16_t)( (uint16_t)t_ms - a.t ) / (float)span;
+      decode( a, b, f, out );
+      return true;
+    }
+
+    // 按路程插值（s_mm 与 Kinematics_c::s 同一基准）
+    bool atDistance( float s_mm, Pose_t &out ) {
+      if ( count == 0 ) return false;
+      uint16_t s_new = at( count - 1 ).s;
+      float back = newest_s - s_mm;
+      if ( back < 0.0f ) return false;
+      uint16_t dist = (uint16_t)(long)lroundf( back * POSE_S_SCALE );
+      if ( dist > (uint16_t)( s_new - at( 0 ).s ) ) return false;
+
+      byte lo = 0;
+      byte hi = count - 1;
+      while ( lo < hi ) {
+        byte mid = ( lo + hi ) / 2;
+        if ( (uint16_t)( s_new - at( mid ).s ) <= dist ) hi = mid;
+        else lo = mid + 1;
+      }
+      if ( lo == 0 ) {
+        decode( at( 0 ), at( 0 ), 0.0f, out );
+        return true;
+      }
+      const PoseRecord_t &a = at( lo - 1 );
+      const PoseRecord_t &b = at( lo );
+      uint16_t span = b.s - a.s;
+      uint16_t into = ( s_new - dist ) - a.s;
+      float f = ( span == 0 ) ? 1.0f : (float)into / (float)span;
+      decode( a, b, f, out );
+      return true;
+    }
+
+  private:
+
+    // i = 0 最老，count-1 最新
+    const PoseRecord_t &at( byte i ) const {
+      return rec[ ( head + POSE_HISTORY_LEN - count + i ) % POSE_HISTORY_LEN ];
+    }
+
+    void decode( const PoseRecord_t &a, const PoseRecord_t &b, float f, Pose_t &out ) {
+      out.x = ( (float)a.x + f * (float)( b.x - a.x ) ) / POSE_XY_SCALE;
+      out.y = ( (float)a.y + f * (float)( b.y - a.y ) ) / POSE_XY_SCALE;
+      int16_t dth = (int16_t)( b.th - a.th );
+      int16_t th = (int16_t)( a.th + (int16_t)lroundf( f * (float)dth ) );
+      out.theta = (float)th / POSE_TH_SCALE;
+      uint16_t s_new = at( count - 1 ).s;
+      float back_a = (float)(uint16_t)( s_new - a.s ) / POSE_S_SCALE;
+      float back_b = (float)(uint16_t)( s_new - b.s ) / POSE_S_SCALE;
+      out.s = newest_s - ( back_a + f * ( back_b - back_a ) );
+    }
+
+};
+
+#endif
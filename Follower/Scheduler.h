@@ -0,0 +1,214 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <Arduino.h>
+
+// 固定频率任务调度器
+// Timer0 每 1.024ms 溢出一次（millis 用的就是它），这里再打开它的 COMPB 中断作为节拍，
+// 不改变 Timer0 的配置，所以 millis()/micros()/PWM 都不受影响。
+// 节拍ISR只负责按 millis 把到期的任务标记为 ready，任务本身在 loop() 里按优先级执行。
+
+#define SCHED_MAX_TASKS 6
+
+typedef void (*TaskFn_t)();
+
+struct SchedTask_t {
+  TaskFn_t fn;
+  unsigned int period_ms;
+  unsigned int deadline_ms;
+  byte priority;             // 数字越小优先级越高
+
+  volatile bool ready;
+  volatile unsigned long next_ms;
+  volatile unsigned long release_us;
+
+  unsigned long last_start_us;
+  unsigned long period_us;   // 这一次与上一次开始执行的间隔（第一次为标称周期）
+  unsigned long exec_min_us;
+  unsigned long exec_max_us;
+  unsigned long exec_sum_us;
+  unsigned long runs;
+  long jitter_min_us;        // 实际周期 - 标称周期
+  long jitter_max_us;
+  unsigned long latency_max_us;  // 释放到开始执行的最长等待
+  unsigned int misses;       // 超过 deadline 的次数
+  unsigned int overruns;     // 上一次还没执行又到期了
+};
+
+class Scheduler_c {
+  public:
+
+    SchedTask_t tasks[ SCHED_MAX_TASKS ];
+    byte num_tasks;
+    volatile bool running;
+    int current;               // 正在执行的任务，没有为 -1
+
+    Scheduler_c() {
+      num_tasks = 0;
+      running = false;
+      current = -1;
+    }
+
+    // 任务里调用：本次实测周期（微秒），给控制器当 dt 用
+    unsigned long periodUs() {
+      if ( current < 0 ) return 0;
+      return tasks[ current ].period_us;
+    }
+
+    // 返回任务编号，失败返回 -1
+    int addTask( TaskFn_t fn, unsigned int period_ms, unsigned int deadline_ms, byte priority ) {
+      if ( num_tasks >= SCHED_MAX_TASKS ) return -1;
+      SchedTask_t &t = tasks[ num_tasks ];
+      t.fn = fn;
+      t.period_ms = period_ms;
+      t.deadline_ms = deadline_ms;
+      t.priority = priority;
+      t.ready = false;
+      resetTaskStats( t );
+      return num_tasks++;
+    }
+
+    void begin() {
+      unsigned long now = millis();
+      for ( byte i = 0; i < num_tasks; i++ ) {
+        tasks[ i ].ready = false;
+        tasks[ i ].next_ms = now + tasks[ i ].period_ms;
+        tasks[ i ].last_start_us = 0;
+      }
+      running = true;
+
+      OCR0B = 128;                 // 任意比较值，每次溢出周期触发一次
+      TIFR0 = ( 1 << OCF0B );
+      TIMSK0 |= ( 1 << OCIE0B );
+    }
+
+    // 停下以后已经就绪的任务也不再执行（否则 loop() 里下一次 run() 还会跑一次 PID，把电机又打开）
+    void stop() {
+      byte sreg = SREG;
+      cli();
+      TIMSK0 &= ~( 1 << OCIE0B );
+      for ( byte i = 0; i < num_tasks; i++ ) tasks[ i ].ready = false;
+      running = false;
+      SREG = sreg;
+    }
+
+    // 只在 ISR 里调用
+    void tick() {
+      unsigned long now = millis();
+      for ( byte i = 0; i < num_tasks; i++ ) {
+        SchedTask_t &t = tasks[ i ];
+        if ( (long)( now - t.next_ms ) >= 0 ) {
+          if ( t.ready ) t.overruns++;
+          t.ready = true;
+          t.release_us = micros();
+          t.next_ms += t.period_ms;
+        }
+      }
+    }
+
+    // 在 loop() 里反复调用，每次执行一个最高优先级的就绪任务
+    // 返回 true 表示执行了任务
+    bool run() {
+      if ( !running ) return false;
+
+      int best = -1;
+      for ( byte i = 0; i < num_tasks; i++ ) {
+        if ( tasks[ i ].ready ) {
+          if ( best < 0 || tasks[ i ].priority < tasks[ best ].priority ) best = i;
+        }
+      }
+      if ( best < 0 ) return false;
+
+      SchedTask_t &t = tasks[ best ];
+
+      byte sreg = SREG;
+      cli();
+      unsigned long release_us = t.release_us;
+      t.ready = false;
+      SREG = sreg;
+
+      unsigned long start_us = micros();
+      if ( t.last_start_us != 0 ) t.period_us = start_us - t.last_start_us;
+      else t.period_us = (unsigned long)t.period_ms * 1000UL;
+
+      current = best;
+      t.fn();
+      current = -1;
+      unsigned long end_us = micros();
+
+      unsigned long exec_us = end_us - start_us;
+      if ( exec_us < t.exec_min_us ) t.exec_min_us = exec_us;
+      if ( exec_us > t.exec_max_us ) t.exec_max_us = exec_us;
+      t.exec_sum_us += exec_us;
+
+      unsigned long latency = start_us - release_us;
+      if ( latency > t.latency_max_us ) t.latency_max_us = latency;
+
+      if ( t.last_start_us != 0 ) {
+        long jitter = (long)t.period_us - (long)t.period_ms * 1000L;
+        if ( jitter < t.jitter_min_us ) t.jitter_min_us = jitter;
+        if ( jitter > t.jitter_max_us ) t.jitter_max_us = jitter;
+      }
+      t.last_start_us = start_us;
+
+      if ( end_us - release_us > (unsigned long)t.deadline_ms * 1000UL ) t.misses++;
+
+      t.runs++;
+      return true;
+    }
+
+    void resetTaskStats( SchedTask_t &t ) {
+      t.last_start_us = 0;
+      t.period_us = (unsigned long)t.period_ms * 1000UL;
+      t.exec_min_us = 0xFFFFFFFFUL;
+      t.exec_max_us = 0;
+      t.exec_sum_us = 0;
+      t.runs = 0;
+      t.jitter_min_us = 0x7FFFFFFFL;
+      t.jitter_max_us = -0x7FFFFFFFL;
+      t.latency_max_us = 0;
+      t.misses = 0;
+      t.overruns = 0;
+    }
+
+    void printStats() {
+      Serial.println("\n========== SCHEDULER STATS (us) ==========");
+      Serial.println("Task,Period_ms,Prio,Runs,Exec_min,Exec_mean,Exec_max,Jitter_min,Jitter_max,Latency_max,Deadline_miss,Overrun");
+      for ( byte i = 0; i < num_tasks; i++ ) {
+        SchedTask_t &t = tasks[ i ];
+        Serial.print( i );
+        Serial.print( "," );
+        Serial.print( t.period_ms );
+        Serial.print( "," );
+        Serial.print( t.priority );
+        Serial.print( "," );
+        Serial.print( t.runs );
+        Serial.print( "," );
+        Serial.print( t.runs ? t.exec_min_us : 0 );
+        Serial.print( "," );
+        Serial.print( t.runs ? t.exec_sum_us / t.runs : 0 );
+        Serial.print( "," );
+        Serial.print( t.exec_max_us );
+        Serial.print( "," );
+        Serial.print( t.runs > 1 ? t.jitter_min_us : 0 );
+        Serial.print( "," );
+        Serial.print( t.runs > 1 ? t.jitter_max_us : 0 );
+        Serial.print( "," );
+        Serial.print( t.latency_max_us );
+        Serial.print( "," );
+        Serial.print( t.misses );
+        Serial.print( "," );
+        Serial.println( t.overruns );
+      }
+      Serial.println("==========================================");
+    }
+
+};
+
+Scheduler_c scheduler;
+
+ISR( TIMER0_COMPB_vect ) {
+  scheduler.tick();
+}
+
+#endif
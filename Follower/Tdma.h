@@ -0,0 +1,74 @@
+#ifndef _TDMA_H
+#define _TDMA_H
+
+// Leader 和 Follower 共用的 IR 时分复用时间表（两边放同一份）
+// 一帧两个时隙：先 bump（leader 前向发射），再 line（leader 向下发射）
+// Leader 用 Tdma_c 按这里切换 EMIT_PIN；Follower 用锁相环对准帧，每个时隙两端各留 2 * TDMA_GUARD_MS 不用，
+// 没锁上时用 Tdma_c 按自己按键开始的时刻推算时隙
+// 时隙最短约 10ms：Follower 的 bump 读数要在 (时隙 - 2*保护) 里至少放进两次、(时隙 - 4*保护) 里至少一次，
+// SENSE_PERIOD_MS 按 TDMA_SLOT_MS 算（Follower.ino 里有 static_assert）
+
+// 两种复用方式（两边要一样）：
+//   IR_MUX_TDMA  按下面的时间表轮流发 bump / line
+//   IR_MUX_FDM   两组发射管各用一个载波同时发（leader Carrier.h 的 beginFdm()），
+//                follower 用 LineSensors.h 的两路锁相解调分开，每个控制周期都有距离和方向
+#define IR_MUX_TDMA    0
+#define IR_MUX_FDM     1
+
+#ifndef IR_MUX
+#define IR_MUX IR_MUX_TDMA
+#endif
+
+#ifndef TDMA_SLOT_MS
+#define TDMA_SLOT_MS   20
+#endif
+
+#ifndef TDMA_GUARD_MS
+#define TDMA_GUARD_MS  3
+#endif
+
+#define TDMA_SLOTS     2
+#define TDMA_FRAME_MS  ( TDMA_SLOT_MS * TDMA_SLOTS )
+
+#define TDMA_SLOT_BUMP 0
+#define TDMA_SLOT_LINE 1
+
+#if TDMA_SLOT_MS < 10
+#error "TDMA_SLOT_MS below 10 ms leaves no room for a bump measurement"
+#endif
+
+#if TDMA_GUARD_MS * 2 >= TDMA_SLOT_MS
+#error "TDMA guard intervals cover the whole slot"
+#endif
+
+class Tdma_c {
+  public:
+
+    unsigned long start_ms;
+    unsigned long slot_count;      // 从 begin() 起经过的时隙数
+
+    Tdma_c() {
+      start_ms = 0;
+      slot_count = 0;
+    }
+
+    void begin( unsigned long now_ms ) {
+      start_ms = now_ms;
+      slot_count = 0;
+    }
+
+    // 进入新时隙时返回 true；按 start_ms 推算，不会累计误差
+    bool update( unsigned long now_ms ) {
+      unsigned long n = ( now_ms - start_ms ) / TDMA_SLOT_MS;
+      if ( n == slot_count ) return false;
+      slot_count = n;
+      return true;
+    }
+
+    byte slotType() {
+      return ( slot_count % TDMA_SLOTS == 0 ) ? TDMA_SLOT_BUMP : TDMA_SLOT_LINE;
+    }
+
+};
+
+#endif
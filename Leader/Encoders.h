@@ -14,6 +14,15 @@
 //#define ENCODER_1_B_PIN Non-standard pin!
 
 
+// Port register bits for the encoder pins.
+// Encoder0: A (XOR) = PE6, B = PF0
+// Encoder1: A (XOR) = PB4, B = PE2
+#define E0_A_BIT  PINE6
+#define E0_B_BIT  PINF0
+#define E1_A_BIT  PINB4
+#define E1_B_BIT  PINE2
+
+
 // Volatile Global variables used by Encoder ISR.
 volatile long count_e0; // used by encoder to count the rotation
 volatile byte state_e0; // used to determine quadrature state
@@ -21,55 +30,60 @@ volatile long count_e1;
 volatile byte state_e1;
 
 
+// A consistent copy of both encoder counts.
+// A long is 4 bytes, so on the 8-bit AVR reading
+// count_e0 takes several instructions and the ISR
+// can change it half way through the read.
+struct EncoderSnapshot_t {
+  long e0;
+  long e1;
+};
+
+// Copy both counts with interrupts off, then put
+// SREG back so interrupts are only re-enabled if
+// they were enabled before.
+inline void readEncoders( EncoderSnapshot_t &snap ) {
+  byte sreg = SREG;
+  cli();
+  snap.e0 = count_e0;
+  snap.e1 = count_e1;
+  SREG = sreg;
+}
+
+
+// Count change for each transition.
+// Index:  (bit3)  (bit2)  (bit1)   (bit0)
+//          new B   new A   old B    old A
+// Same result as the old if/else chain:
+// 1, 7, 8, 14 -> -1 and 2, 4, 11, 13 -> +1.
+// All other transitions are invalid or no
+// movement, so they count 0.
+const int8_t enc_step_table[16] = {
+   0, -1, +1,  0,
+  +1,  0,  0, -1,
+  -1,  0,  0, +1,
+   0, +1, -1,  0
+};
+
+
 // This ISR handles just Encoder 1
 // ISR to read the Encoder1 Channel A and B pins
 // and then look up based on  transition what kind of
 // rotation must have occured.
 ISR( INT6_vect ) {
-  // We know that the ISR is only called when a pin changes.
-  // We also know only 1 pin can change at a time.
-  // The XOR(AB) signal change from "Channel A" triggers ISR.
-
-  // First, Read in the new state of the encoder pins.
-  // Standard pins, so standard read functions.
-  boolean e0_B = digitalRead( ENCODER_0_B_PIN ); // normal B state
-  boolean e0_A = digitalRead( ENCODER_0_A_PIN ); // XOR(AB)
-
-  // Software XOR (^) logically infers
-  // the true value of A given the state of B
-  e0_A = e0_A ^ e0_B;
-
-  // Shift our (new) current readings into bit positions
-  // 2 and 3 in the state variable (current state)
-  // State: (bit3)  (bit2)  (bit1)   (bit0)
-  // State:  new B   new A   old B   old A
-  state_e0 = state_e0 | ( e0_B  << 3 );
-  state_e0 = state_e0 | ( e0_A  << 2 );
-
-  if ( state_e0 == 1 ) {
-    count_e0--;
-  } else if ( state_e0 == 2) {
-    count_e0++;
-  } else if ( state_e0 == 4) {
-    count_e0++;
-  } else if ( state_e0 == 7) {
-    count_e0--;
-  } else if ( state_e0 == 8) {
-    count_e0--;
-  } else if ( state_e0 == 11) {
-    count_e0++;
-  } else if ( state_e0 == 13) {
-    count_e0++;
-  } else if ( state_e0 == 14) {
-    count_e0--;
-  }
-
-  // Shift the current readings (bits 3 and 2) down
-  // into position 1 and 0 (to become prior readings)
-  // This bumps bits 1 and 0 off to the right, "deleting"
-  // them for the next ISR call.
-  state_e0 = state_e0 >> 2;
-
+  // Read the pins straight from the PIN registers,
+  // digitalRead() is far too slow inside an ISR.
+  byte e0_B = ( PINF >> E0_B_BIT ) & 1;         // normal B state
+  byte e0_A = ( ( PINE >> E0_A_BIT ) & 1 ) ^ e0_B; // XOR(AB) -> true A
+
+  // Put the new readings in bits 3 and 2 next
+  // to the old readings in bits 1 and 0, then
+  // look the transition up in the table.
+  byte s = state_e0 | ( e0_B << 3 ) | ( e0_A << 2 );
+  count_e0 += enc_step_table[ s ];
+
+  // New readings become the prior readings.
+  state_e0 = s >> 2;
 }
 
 
@@ -81,61 +95,15 @@ ISR( INT6_vect ) {
 // rotation must have occured.
 ISR( PCINT0_vect ) {
 
-  // First, Read in the new state of the encoder pins.
-
-  // Mask for a specific pin from the port.
-  // Non-standard pin, so we access the register
-  // directly.
-  // Reading just PINE would give us a number
-  // composed of all 8 bits.  We want only bit 2.
-  // B00000100 masks out all but bit 2
-  // It is more portable to use the PINE2 keyword.
-  boolean e1_B = PINE & (1 << PINE2);
-  //boolean e1_B = PINE & B00000100;  // Does same as above.
-
-  // Standard read from the other pin.
-  boolean e1_A = digitalRead( ENCODER_1_A_PIN ); // 26 the same as A8
+  // PE2 is a non-standard pin and A8 is PB4, both
+  // are read straight from their port registers.
+  byte e1_B = ( PINE >> E1_B_BIT ) & 1;
+  byte e1_A = ( ( PINB >> E1_A_BIT ) & 1 ) ^ e1_B;
 
+  byte s = state_e1 | ( e1_B << 3 ) | ( e1_A << 2 );
+  count_e1 += enc_step_table[ s ];
 
-  e1_A = e1_A ^ e1_B;
-
-  // Create a bitwise representation of our states
-  // We do this by shifting the boolean value up by
-  // the appropriate number of bits, as per our table
-  // header:
-  //
-  // State :  (bit3)  (bit2)  (bit1)  (bit0)
-  // State :  New A,  New B,  Old A,  Old B.
-  state_e1 = state_e1 | ( e1_B  << 3 );
-  state_e1 = state_e1 | ( e1_A  << 2 );
-
-
-  // This is an inefficient way of determining
-  // the direction.  However it illustrates well
-  // against the lecture slides.
-  if ( state_e1 == 1 ) {
-    count_e1--;
-  } else if ( state_e1 == 2) {
-    count_e1++;
-  } else if ( state_e1 == 4) {
-    count_e1++;
-  } else if ( state_e1 == 7) {
-    count_e1--;
-  } else if ( state_e1 == 8) {
-    count_e1--;
-  } else if ( state_e1 == 11) {
-    count_e1++;
-  } else if ( state_e1 == 13) {
-    count_e1++;
-  } else if ( state_e1 == 14) {
-    count_e1--;
-  }
-
-  // Shift the current readings (bits 3 and 2) down
-  // into position 1 and 0 (to become prior readings)
-  // This bumps bits 1 and 0 off to the right, "deleting"
-  // them for the next ISR call.
-  state_e1 = state_e1 >> 2;
+  state_e1 = s >> 2;
 }
 
 
@@ -3,22 +3,39 @@
 
 #include <math.h>
 
-// These two commands mean that this header file
-// will attempt to use some global variables of
-// the same name found in another header file.
-// From encoders.h
-extern volatile long count_e0;
-extern volatile long count_e1;
+// Encoder counts are read through readEncoders()
+// from encoders.h, never straight from count_e0/e1.
+#include "Encoders.h"
+
+// Wheel radius / separation: if the sketch folder has a
+// RobotProfile.h from calibrate_odometry.py, use the
+// calibrated values instead of the defaults below.
+#if __has_include("RobotProfile.h")
+#include "RobotProfile.h"
+#endif
+
+#ifndef ROBOT_WHEEL_RADIUS_L
+#define ROBOT_WHEEL_RADIUS_L 17.475
+#endif
+#ifndef ROBOT_WHEEL_RADIUS_R
+#define ROBOT_WHEEL_RADIUS_R 17.475
+#endif
+#ifndef ROBOT_WHEEL_SEP
+#define ROBOT_WHEEL_SEP 44.48
+#endif
 
 const float count_per_rev = 358.3;   // From documentation - correct.
-const float wheel_radius  = 17.475;    // 17.3741mm, could vary - calibrate.
-const float wheel_sep     = 44.48;  // 44.48mm, from centre of robot to wheel centre 
-                                     //     - could vary, calibrate
+const float wheel_radius_l = ROBOT_WHEEL_RADIUS_L;   // e1
+const float wheel_radius_r = ROBOT_WHEEL_RADIUS_R;   // e0
+const float wheel_radius  = ( wheel_radius_l + wheel_radius_r ) / 2.0;
+const float wheel_sep     = ROBOT_WHEEL_SEP;  // from centre of robot to wheel centre
 
 // Take the circumference of the wheel and divide by the 
 // number of counts per revolution. This provides the mm
-// travelled per encoder count.
+// travelled per encoder count (each wheel separately).
 const float mm_per_count  = ( 2.0 * wheel_radius * PI ) / count_per_rev;
+const float mm_per_count_l = ( 2.0 * wheel_radius_l * PI ) / count_per_rev;
+const float mm_per_count_r = ( 2.0 * wheel_radius_r * PI ) / count_per_rev;
 
 // Class to track robot position.
 class Kinematics_c {
@@ -40,8 +57,10 @@ class Kinematics_c {
 
     // Used to setup kinematics, and to set a start position
     void initialise( float start_x, float start_y, float start_th ) {
-      last_e0 = count_e0; // Initisalise last count to current count
-      last_e1 = count_e1; // Initisalise last count to current count
+      EncoderSnapshot_t enc;
+      readEncoders( enc );
+      last_e0 = enc.e0; // Initisalise last count to current count
+      last_e1 = enc.e1; // Initisalise last count to current count
       x = start_x;
       y = start_y;
       theta = start_th;
@@ -55,6 +74,13 @@ class Kinematics_c {
     // extra computation just to get back to distance, which
     // we had in the first place (as change of encoder counts)
     void update( ) {
+        EncoderSnapshot_t enc;
+        readEncoders( enc );
+        update( enc );
+    }
+
+    // Same, using a snapshot the caller already took.
+    void update( const EncoderSnapshot_t &enc ) {
       
         long delta_e1;  // change in counts
         long delta_e0;  // change in counts
@@ -64,25 +90,24 @@ class Kinematics_c {
         float th_contribution;  // rotation
 
         // How many counts since last update()?
-        delta_e1 = count_e1 - last_e1;
-        delta_e0 = count_e0 - last_e0;
+        delta_e1 = enc.e1 - last_e1;
+        delta_e0 = enc.e0 - last_e0;
 
         // Used last encoder values, so now update to
         // current for next iteration
-        last_e1 = count_e1;
-        last_e0 = count_e0;
+        last_e1 = enc.e1;
+        last_e0 = enc.e0;
         
         // Work out x contribution in local frame.
-        mean_delta = (float)delta_e1;
-        mean_delta += (float)delta_e0;
+        mean_delta = (float)delta_e1 * mm_per_count_l;
+        mean_delta += (float)delta_e0 * mm_per_count_r;
         mean_delta /= 2.0;
 
-        x_contribution = mean_delta * mm_per_count;
+        x_contribution = mean_delta;
 
         // Work out rotation in local frame
-        th_contribution = (float)delta_e0;
-        th_contribution -= (float)delta_e1;
-        th_contribution *= mm_per_count;
+        th_contribution = (float)delta_e0 * mm_per_count_r;
+        th_contribution -= (float)delta_e1 * mm_per_count_l;
         th_contribution /= (wheel_sep *2.0);
 
 
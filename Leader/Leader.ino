@@ -2,6 +2,8 @@
 #include "Motors.h"
 #include "PID.h"
 #include "Kinematics.h"
+#include "Tdma.h"
+#include "Carrier.h"
 
 #define EMIT_PIN 11
 #define BTN_PIN 14
@@ -11,8 +13,8 @@ Motors_c motors;
 Kinematics_c kin;
 PID_c pidL, pidR;
 
-unsigned long ir_ts = 0;
-bool ir_bump_mode = true;
+// IR emitter schedule shared with the follower (see Tdma.h)
+Tdma_c tdma;
 
 unsigned long beep_off_time = 0;
 
@@ -46,7 +48,12 @@ void setup() {
   }
 
   softBeep(40);
-  ir_ts = millis();
+#if IR_MUX == IR_MUX_FDM
+  carrier.beginFdm();
+#else
+  tdma.begin(millis());
+  digitalWrite(EMIT_PIN, LOW);
+#endif
 }
 
 void loop() {
@@ -57,14 +64,13 @@ void loop() {
     beep_off_time = 0;
   }
 
-  if (now - ir_ts >= 100) {
-    ir_ts = now;
-    ir_bump_mode = !ir_bump_mode;
-
-    if (ir_bump_mode)
+#if IR_MUX == IR_MUX_TDMA
+  if (tdma.update(now)) {
+    if (tdma.slotType() == TDMA_SLOT_BUMP)
       digitalWrite(EMIT_PIN, LOW);
     else
       digitalWrite(EMIT_PIN, HIGH);
   }
+#endif
 }
 
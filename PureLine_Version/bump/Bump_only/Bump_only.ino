@@ -2,6 +2,7 @@
 #include "Motors.h"
 #include "PID.h"
 #include "Kinematics.h"
+#include "BumpTimer.h"
 
 #define BUMP_L 4
 #define BUMP_R 5
@@ -58,6 +59,12 @@ float spdL = 0, spdR = 0;
 unsigned long last_d = 9999;
 unsigned long last_signal_time = 0;
 
+// 跟随时bump在后台测，每 BUMP_SAMPLE_MS 开始一次，控制里用最近一次的结果
+#define BUMP_SAMPLE_MS 5
+unsigned long bump_dL = 9999;
+unsigned long bump_dR = 9999;
+unsigned long bump_sample_ts = 0;
+
 unsigned long readBump(int pin);
 float mapIRtoCS(unsigned long d);
 void beep(int duration);
@@ -66,6 +73,7 @@ void printResults();
 void updateWheelSpeed();
 void updateFollowingControl();
 bool hasSignal();
+void pollBump();
 
 void setup() {
   Serial.begin(115200);
@@ -84,6 +92,7 @@ void setup() {
   
   pinMode(BUMP_L, INPUT);
   pinMode(BUMP_R, INPUT);
+  bump_timer.initialise();
   pinMode(EMIT_PIN, INPUT);
   digitalWrite(EMIT_PIN, LOW);
   
@@ -97,8 +106,10 @@ void setup() {
   beep(100);
   
   ts_est = ts_pid = millis();
-  last_e0 = count_e0;
-  last_e1 = count_e1;
+  EncoderSnapshot_t enc;
+  readEncoders(enc);
+  last_e0 = enc.e0;
+  last_e1 = enc.e1;
   results_index = 0;
   
   robot_state = STATE_WAIT_SIGNAL;
@@ -117,9 +128,12 @@ void loop() {
         if (now - last_check >= 300) {
           last_check = now;
           
+          // 等待时每 300ms 才读一次，用阻塞读法就够了
           unsigned long dL = readBump(BUMP_L);
           unsigned long dR = readBump(BUMP_R);
           unsigned long d = (dL + dR) / 2;
+          bump_dL = dL;
+          bump_dR = dR;
           
           Serial.print("Waiting... L=");
           Serial.print(dL);
@@ -132,6 +146,12 @@ void loop() {
           Serial.println(")");
           
           if (hasSignal()) {
+            // 超过 LOST_TH 本来就算丢失，上限不必比它更高
+            unsigned long cap = bump_timer.calibrateCap(d, LOST_TH);
+            Serial.print("Bump cap: ");
+            Serial.print(cap);
+            Serial.println(" us");
+            
             robot_state = STATE_FOLLOWING;
             last_signal_time = now;
             experiment_start_ts = now;
@@ -145,6 +165,7 @@ void loop() {
       break;
     
     case STATE_FOLLOWING:
+      pollBump();
       updateWheelSpeed();
       
       kin.update();
@@ -209,8 +230,8 @@ void loop() {
 void updateFollowingControl() {
   unsigned long now = millis();
   
-  unsigned long dL = readBump(BUMP_L);
-  unsigned long dR = readBump(BUMP_R);
+  unsigned long dL = bump_dL;
+  unsigned long dR = bump_dR;
   unsigned long d = (dL + dR) / 2;
   
   rec_dL = dL;
@@ -233,8 +254,10 @@ void updateFollowingControl() {
   if (now - ts_est >= DRIVE_EST_MS) {
     ts_est = now;
     
-    long e0 = count_e0;
-    long e1 = count_e1;
+    EncoderSnapshot_t enc;
+    readEncoders(enc);
+    long e0 = enc.e0;
+    long e1 = enc.e1;
     
     long de0 = e0 - last_e0;
     long de1 = e1 - last_e1;
@@ -301,20 +324,34 @@ float mapIRtoCS(unsigned long d) {
 }
 
 bool hasSignal() {
-  unsigned long dL = readBump(BUMP_L);
-  unsigned long dR = readBump(BUMP_R);
-  unsigned long d = (dL + dR) / 2;
+  unsigned long d = (bump_dL + bump_dR) / 2;
   return (d > SIGNAL_THRESHOLD && d < LOST_TH);
 }
 
+// 取回后台测量的结果，到时间就开始下一次
+void pollBump() {
+  BumpSample_t bs;
+  if (bump_timer.read(bs)) {
+    bump_dL = bs.left_us;
+    bump_dR = bs.right_us;
+  }
+  unsigned long now = millis();
+  if (!bump_timer.busy() && now - bump_sample_ts >= BUMP_SAMPLE_MS) {
+    bump_sample_ts = now;
+    bump_timer.start();
+  }
+}
+
 void updateWheelSpeed() {
   unsigned long now = millis();
   if (now - ts_est >= DRIVE_EST_MS) {
     unsigned long dt = now - ts_est;
     ts_est = now;
     
-    long e0 = count_e0;
-    long e1 = count_e1;
+    EncoderSnapshot_t enc;
+    readEncoders(enc);
+    long e0 = enc.e0;
+    long e1 = enc.e1;
     long d0 = e0 - last_e0;
     long d1 = e1 - last_e1;
     last_e0 = e0;
@@ -371,8 +408,9 @@ void printResults() {
   }
 }
 
+// pin 6 的 analogWrite 用的是 Timer4，已经给 bump 计时用了，改用 tone()
 void beep(int duration) {
-  analogWrite(BUZZ_PIN, 120);
+  tone(BUZZ_PIN, 800);
   delay(duration);
-  analogWrite(BUZZ_PIN, 0);
+  noTone(BUZZ_PIN);
 }
@@ -1,8 +1,11 @@
+// #define IRMAP_BENCHMARK   // 上电后打印查表和 expf 的耗时、查表的最大误差
+
 #include "Encoders.h"
 #include "Motors.h"
 #include "PID.h"
 #include "Kinematics.h"
 #include "LineSensors.h"
+#include "IrMap.h"
 
 #define BUMP_L 4
 #define BUMP_R 5
@@ -106,21 +109,11 @@ bool isJumpCloseAndShift(unsigned long a, unsigned long b) {
   return (a >= 150 && a <= 200 && b >= 300 && (b - a) >= 80);
 }
 
-float mapIRtoCS(unsigned long raw) {
-  const float V_MIN = 0.0f;
-  const float V_MAX = 250.0f;
-  const float C     = 180.0f;
-  const float K     = 20.0f;
-
-  if (raw <= 150) return 0.0f;
+// sigmoid：C = 180, K = 20, V_MAX = 250，编译期生成查找表
+typedef IrMap_c<180, 20, 250> IrMapCS;
 
-  float x = ((float)raw - C) / K;
-  float s = 1.0f / (1.0f + expf(-x));
-  float v = V_MIN + (V_MAX - V_MIN) * s;
-
-  if (v < 0.0f) v = 0.0f;
-  if (v > V_MAX) v = V_MAX;
-  return v;
+float mapIRtoCS(unsigned long raw) {
+  return IrMapCS::lookup(raw);
 }
 
 float mapIRtoCS_withSafety(unsigned long raw, unsigned long last) {
@@ -136,6 +129,10 @@ void setup() {
   digitalWrite(LED_RED, LOW);
 
   motors.initialise();
+#ifdef IRMAP_BENCHMARK
+  delay(2000);
+  IrMapCS::benchmark(1000);
+#endif
   setupEncoder0();
   setupEncoder1();
 
@@ -193,8 +190,10 @@ void setup() {
 
   t0 = millis();
 
-  last_e0 = count_e0;
-  last_e1 = count_e1;
+  EncoderSnapshot_t enc;
+  readEncoders(enc);
+  last_e0 = enc.e0;
+  last_e1 = enc.e1;
   ts_est = millis();
   ts_pid = millis();
 
@@ -232,8 +231,10 @@ void loop() {
 
   if (now - ts_est >= 20) {
     unsigned long dt = now - ts_est;
-    long e0 = count_e0;
-    long e1 = count_e1;
+    EncoderSnapshot_t enc;
+    readEncoders(enc);
+    long e0 = enc.e0;
+    long e1 = enc.e1;
     float dt_sec = (float)dt / 1000.0f;
     if (dt_sec > 0.0f) {
       spdR = (float)(e0 - last_e0) / dt_sec;
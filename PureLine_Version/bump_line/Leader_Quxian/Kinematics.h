@@ -3,15 +3,32 @@
 #define _KINEMATICS_H
 
 #include <math.h>
+#include "Encoders.h"
 
-extern volatile long count_e0;
-extern volatile long count_e1;
+// 轮径/轮距：如果草图目录里有 calibrate_odometry.py 生成的 RobotProfile.h 就用标定值
+#if __has_include("RobotProfile.h")
+#include "RobotProfile.h"
+#endif
+
+#ifndef ROBOT_WHEEL_RADIUS_L
+#define ROBOT_WHEEL_RADIUS_L 17.475
+#endif
+#ifndef ROBOT_WHEEL_RADIUS_R
+#define ROBOT_WHEEL_RADIUS_R 17.475
+#endif
+#ifndef ROBOT_WHEEL_SEP
+#define ROBOT_WHEEL_SEP 44.48
+#endif
 
 const float count_per_rev = 358.3;
-const float wheel_radius  = 17.475;
-const float wheel_sep     = 44.48;
+const float wheel_radius_l = ROBOT_WHEEL_RADIUS_L;   // e1
+const float wheel_radius_r = ROBOT_WHEEL_RADIUS_R;   // e0
+const float wheel_radius  = ( wheel_radius_l + wheel_radius_r ) / 2.0;
+const float wheel_sep     = ROBOT_WHEEL_SEP;
 
 const float mm_per_count  = ( 2.0 * wheel_radius * PI ) / count_per_rev;
+const float mm_per_count_l = ( 2.0 * wheel_radius_l * PI ) / count_per_rev;
+const float mm_per_count_r = ( 2.0 * wheel_radius_r * PI ) / count_per_rev;
 
 class Kinematics_c {
   public:
@@ -26,14 +43,22 @@ class Kinematics_c {
     } 
 
     void initialise( float start_x, float start_y, float start_th ) {
-      last_e0 = count_e0;
-      last_e1 = count_e1;
+      EncoderSnapshot_t enc;
+      readEncoders( enc );
+      last_e0 = enc.e0;
+      last_e1 = enc.e1;
       x = start_x;
       y = start_y;
       theta = start_th;
     }
     
     void update( ) {
+        EncoderSnapshot_t enc;
+        readEncoders( enc );
+        update( enc );
+    }
+
+    void update( const EncoderSnapshot_t &enc ) {
       
         long delta_e1;
         long delta_e0;
@@ -42,21 +67,20 @@ class Kinematics_c {
         float x_contribution;
         float th_contribution;
 
-        delta_e1 = count_e1 - last_e1;
-        delta_e0 = count_e0 - last_e0;
+        delta_e1 = enc.e1 - last_e1;
+        delta_e0 = enc.e0 - last_e0;
 
-        last_e1 = count_e1;
-        last_e0 = count_e0;
+        last_e1 = enc.e1;
+        last_e0 = enc.e0;
         
-        mean_delta = (float)delta_e1;
-        mean_delta += (float)delta_e0;
+        mean_delta = (float)delta_e1 * mm_per_count_l;
+        mean_delta += (float)delta_e0 * mm_per_count_r;
         mean_delta /= 2.0;
 
-        x_contribution = mean_delta * mm_per_count;
+        x_contribution = mean_delta;
 
-        th_contribution = (float)delta_e0;
-        th_contribution -= (float)delta_e1;
-        th_contribution *= mm_per_count;
+        th_contribution = (float)delta_e0 * mm_per_count_r;
+        th_contribution -= (float)delta_e1 * mm_per_count_l;
         th_contribution /= (wheel_sep *2.0);
 
         x = x + x_contribution * cos( theta );
@@ -104,8 +104,10 @@ void loop() {
     unsigned long dt = now - drive_est_ts;
     drive_est_ts = now;
 
-    long e0 = count_e0;
-    long e1 = count_e1;
+    EncoderSnapshot_t enc;
+    readEncoders(enc);
+    long e0 = enc.e0;
+    long e1 = enc.e1;
     long d0 = e0 - d_last_e0;
     long d1 = e1 - d_last_e1;
     d_last_e0 = e0;
@@ -6,77 +6,123 @@
 #define ENCODER_0_B_PIN  23
 #define ENCODER_1_A_PIN  26
 
+// 端口寄存器位置（3Pi+ 32U4）
+// E0: A = PE6 (XOR), B = PF0
+// E1: A = PB4 (XOR), B = PE2
+#define E0_A_BIT  PINE6
+#define E0_B_BIT  PINF0
+#define E1_A_BIT  PINB4
+#define E1_B_BIT  PINE2
+
 volatile long count_e0;
 volatile byte state_e0;
 volatile long count_e1;
 volatile byte state_e1;
 
-ISR( INT6_vect ) {
-  boolean e0_B = digitalRead( ENCODER_0_B_PIN );
-  boolean e0_A = digitalRead( ENCODER_0_A_PIN );
-
-  e0_A = e0_A ^ e0_B;
+// 每个轮子最近一个有效边沿的时间（micros）
+volatile unsigned long edge_us_e0;
+volatile unsigned long edge_us_e1;
+
+// 编码器一致快照：两个计数 + 边沿时间在同一次关中断内取出
+// 32位变量在8位AVR上读取不是原子的，直接读count_e0可能读到ISR改了一半的值
+struct EncoderSnapshot_t {
+  long e0;
+  long e1;
+  unsigned long t_e0;
+  unsigned long t_e1;
+};
+
+// 只在拷贝16个字节期间关中断，之后恢复原来的SREG
+inline void readEncoders( EncoderSnapshot_t &snap ) {
+  byte sreg = SREG;
+  cli();
+  snap.e0 = count_e0;
+  snap.e1 = count_e1;
+  snap.t_e0 = edge_us_e0;
+  snap.t_e1 = edge_us_e1;
+  SREG = sreg;
+}
 
-  state_e0 = state_e0 | ( e0_B  << 3 );
-  state_e0 = state_e0 | ( e0_A  << 2 );
-
-  if ( state_e0 == 1 ) {
-    count_e0--;
-  } else if ( state_e0 == 2) {
-    count_e0++;
-  } else if ( state_e0 == 4) {
-    count_e0++;
-  } else if ( state_e0 == 7) {
-    count_e0--;
-  } else if ( state_e0 == 8) {
-    count_e0--;
-  } else if ( state_e0 == 11) {
-    count_e0++;
-  } else if ( state_e0 == 13) {
-    count_e0++;
-  } else if ( state_e0 == 14) {
-    count_e0--;
+// 编码器边沿时间戳环形缓冲区（单生产者ISR / 单消费者loop）
+// ISR只写head，loop只写tail，满了就丢弃新边沿并置overflow
+#define ENC_EDGE_BUF 16   // 必须是2的幂
+
+struct EdgeRing_t {
+  volatile unsigned long t_us[ ENC_EDGE_BUF ];
+  volatile int8_t dir[ ENC_EDGE_BUF ];
+  volatile byte head;
+  volatile byte tail;
+  volatile bool overflow;
+};
+
+EdgeRing_t edges_e0;
+EdgeRing_t edges_e1;
+
+inline void pushEdge( EdgeRing_t &r, unsigned long t, int8_t d ) {
+  byte next = ( r.head + 1 ) & ( ENC_EDGE_BUF - 1 );
+  if ( next == r.tail ) {
+    r.overflow = true;
+    return;
   }
-
-  state_e0 = state_e0 >> 2;
-
+  r.t_us[ r.head ] = t;
+  r.dir[ r.head ] = d;
+  r.head = next;
 }
 
-ISR( PCINT0_vect ) {
-
-  boolean e1_B = PINE & (1 << PINE2);
-
-  boolean e1_A = digitalRead( ENCODER_1_A_PIN );
+inline bool popEdge( EdgeRing_t &r, unsigned long &t, int8_t &d ) {
+  byte tail = r.tail;
+  if ( tail == r.head ) return false;
+  t = r.t_us[ tail ];
+  d = r.dir[ tail ];
+  r.tail = ( tail + 1 ) & ( ENC_EDGE_BUF - 1 );
+  return true;
+}
 
-  e1_A = e1_A ^ e1_B;
+// 状态 = (新B << 3) | (新A << 2) | (旧B << 1) | 旧A
+// 与原if/else链的增减一致：1,7,8,14 -> -1；2,4,11,13 -> +1；其余为0
+const int8_t enc_step_table[16] = {
+   0, -1, +1,  0,
+  +1,  0,  0, -1,
+  -1,  0,  0, +1,
+   0, +1, -1,  0
+};
 
-  state_e1 = state_e1 | ( e1_B  << 3 );
-  state_e1 = state_e1 | ( e1_A  << 2 );
-
-  if ( state_e1 == 1 ) {
-    count_e1--;
-  } else if ( state_e1 == 2) {
-    count_e1++;
-  } else if ( state_e1 == 4) {
-    count_e1++;
-  } else if ( state_e1 == 7) {
-    count_e1--;
-  } else if ( state_e1 == 8) {
-    count_e1--;
-  } else if ( state_e1 == 11) {
-    count_e1++;
-  } else if ( state_e1 == 13) {
-    count_e1++;
-  } else if ( state_e1 == 14) {
-    count_e1--;
+ISR( INT6_vect ) {
+  byte e0_B = ( PINF >> E0_B_BIT ) & 1;
+  byte e0_A = ( ( PINE >> E0_A_BIT ) & 1 ) ^ e0_B;
+
+  byte s = state_e0 | ( e0_B << 3 ) | ( e0_A << 2 );
+  int8_t step = enc_step_table[ s ];
+  if ( step != 0 ) {
+    unsigned long t = micros();
+    count_e0 += step;
+    edge_us_e0 = t;
+    pushEdge( edges_e0, t, step );
   }
+  state_e0 = s >> 2;
+}
 
-  state_e1 = state_e1 >> 2;
+ISR( PCINT0_vect ) {
+  byte e1_B = ( PINE >> E1_B_BIT ) & 1;
+  byte e1_A = ( ( PINB >> E1_A_BIT ) & 1 ) ^ e1_B;
+
+  byte s = state_e1 | ( e1_B << 3 ) | ( e1_A << 2 );
+  int8_t step = enc_step_table[ s ];
+  if ( step != 0 ) {
+    unsigned long t = micros();
+    count_e1 += step;
+    edge_us_e1 = t;
+    pushEdge( edges_e1, t, step );
+  }
+  state_e1 = s >> 2;
 }
 
 void setupEncoder0()
 {
   count_e0 = 0;
+  edges_e0.head = 0;
+  edges_e0.tail = 0;
+  edges_e0.overflow = false;
 
   pinMode( ENCODER_0_A_PIN, INPUT );
   pinMode( ENCODER_0_B_PIN, INPUT );
@@ -103,6 +149,9 @@ void setupEncoder0()
 void setupEncoder1(){
 
   count_e1 = 0;
+  edges_e1.head = 0;
+  edges_e1.tail = 0;
+  edges_e1.overflow = false;
 
   DDRE = DDRE & ~(1 << DDE6);
 
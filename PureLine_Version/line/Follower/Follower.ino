@@ -1,8 +1,16 @@
+// 线传感器：每路 16 个样本过采样 + 中值去尖峰，约 120 帧/秒
+#define LINE_ADC_OVERSAMPLE 2
+#define LINE_ADC_MEDIAN     1
+// leader 发 434Hz 载波（Leader 的 LEADER_CARRIER 1），这里锁相解调，不再依赖开机时的背景值
+#define LINE_ADC_LOCKIN     1
+
 #include "Encoders.h"
 #include "Kinematics.h"
 #include "Motors.h"
 #include "LineSensors.h"
 #include "PID.h"
+#include "WheelSpeed.h"
+#include "RunLog.h"
 
 #define EMIT_PIN 11
 #define BUZZ_PIN 6
@@ -15,13 +23,12 @@ Kinematics_c kin;
 LineSensors_c line_sensors;
 PID_c distance_pid;
 
-#define MAX_RESULTS 15
-#define VARIABLES 10
-float results[MAX_RESULTS][VARIABLES];
-int results_index = 0;
-unsigned long record_ts = 0;
+// 每 LOG_EVERY 个控制周期记一条（定点、环形缓冲，见 RunLog.h）
+// 8 x 25ms = 200ms，30 条正好盖住 6s 的实验（原来 400ms 一条）；改成 1 就是按控制频率记最后 0.75s
+RunLog_c run_log;
+#define LOG_EVERY 8
+byte log_tick = 0;
 unsigned long experiment_start_ts = 0;
-#define RECORD_INTERVAL_MS 400
 #define EXPERIMENT_DURATION_MS 6000
 
 float rec_IR_center = 0;
@@ -47,6 +54,11 @@ int robot_state = STATE_IDLE;
 #define DIST_KI 0.002f
 #define DIST_KD 0.4f
 
+// SIGNAL_THRESHOLD、STEER_DEADBAND 和 rec_*_signal 的单位：leader 让线传感器读数变了多少（ADC 计数），
+// 两种模式都减掉 calibrateSensors() 时 leader 关着的水平：
+//   不锁相  背景 - 读数（leader 常亮）
+//   锁相    载波幅度 - 噪声底（幅度是载波开/关两态之差，和常亮时的 背景 - 读数 是同一个量）
+// 所以两种模式用同一组阈值；leader 换成 LEADER_CARRIER 0 常亮时要用不锁相的模式
 #define STEER_DEADBAND 40
 #define STEER_CLAMP 60
 #define STEER_NORM 100.0f
@@ -74,7 +86,8 @@ unsigned long last_update_time = 0;
 
 #define SPEED_EST_MS 20
 unsigned long speed_est_ts = 0;
-long last_e0 = 0, last_e1 = 0;
+WheelSpeed_c wsL;
+WheelSpeed_c wsR;
 float spdL_cps = 0.0f;
 float spdR_cps = 0.0f;
 
@@ -83,6 +96,9 @@ void setupIRReceiver();
 void calibrateSensors();
 float getCenterIRValue();
 float getSteerFromLine();
+void readLineFrame();
+float leaderSignal(int sensor);
+int sideSignal(int sensor, int offset);
 void updateFollowingControl();
 bool hasSignal();
 void waitForButton();
@@ -107,7 +123,7 @@ void setup() {
   setupEncoder1();
   kin.initialise(0, 0, 0);
   
-  line_sensors.initialiseForADC();
+  line_sensors.beginADC();
   
   distance_pid.initialise(DIST_KP, DIST_KI, DIST_KD);
   distance_pid.setOutputLimits(SPEED_MIN, SPEED_MAX);
@@ -127,13 +143,15 @@ void setup() {
   calibrateSensors();
   
   robot_state = STATE_WAIT_SIGNAL;
-  Serial.println("Waiting for Leader signal...");
+  Serial.println(F("Waiting for Leader signal..."));
   
   last_update_time = millis();
   speed_est_ts = millis();
-  last_e0 = count_e0;
-  last_e1 = count_e1;
-  results_index = 0;
+  EncoderSnapshot_t enc;
+  readEncoders(enc);
+  wsR.initialise(edges_e0, enc.e0, micros());
+  wsL.initialise(edges_e1, enc.e1, micros());
+  run_log.reset();
 }
 
 void loop() {
@@ -149,22 +167,23 @@ void loop() {
         if (now - last_check >= 300) {
           last_check = now;
           
+          readLineFrame();
           float center_value = getCenterIRValue();
           
-          Serial.print("Waiting... IR=");
+          Serial.print(F("Waiting... IR="));
           Serial.print(center_value, 1);
-          Serial.print(" (threshold=");
+          Serial.print(F(" (threshold="));
           Serial.print(SIGNAL_THRESHOLD, 0);
-          Serial.println(")");
+          Serial.println(F(")"));
           
           if (hasSignal()) {
             robot_state = STATE_FOLLOWING;
             last_signal_time = now;
             experiment_start_ts = now;
-            record_ts = now;
+            log_tick = 0;
             
             beep(200);
-            Serial.println("\nLeader detected! Starting to follow...\n");
+            Serial.println(F("\nLeader detected! Starting to follow...\n"));
           }
         }
       }
@@ -178,6 +197,9 @@ void loop() {
         
         kin.update();
         
+        // 本拍只取一次最新帧，下面几个函数都用它
+        readLineFrame();
+        
         float ir_value = getCenterIRValue();
         float steer_value = getSteerFromLine();
         
@@ -185,7 +207,7 @@ void loop() {
           motors.setPWM(0, 0);
           robot_state = STATE_FINISHED;
           beep(300);
-          Serial.println("\nExperiment time finished!");
+          Serial.println(F("\nExperiment time finished!"));
           break;
         }
         
@@ -194,8 +216,8 @@ void loop() {
           
           updateFollowingControl();
           
-          if (now - record_ts >= RECORD_INTERVAL_MS) {
-            record_ts = now;
+          if (++log_tick >= LOG_EVERY) {
+            log_tick = 0;
             recordData();
           }
           
@@ -203,7 +225,7 @@ void loop() {
           if (now - last_signal_time > SIGNAL_LOST_TIME) {
             motors.setPWM(0, 0);
             robot_state = STATE_FINISHED;
-            Serial.println("\nSignal lost! Stopping...");
+            Serial.println(F("\nSignal lost! Stopping..."));
           }
         }
         
@@ -211,26 +233,23 @@ void loop() {
         if (now - last_debug >= 300) {
           last_debug = now;
           
-          line_sensors.readSensorsADC();
-          int L_sig = line_L_offset - (int)line_sensors.readings[0];
-          int R_sig = line_R_offset - (int)line_sensors.readings[4];
-          if (L_sig < 0) L_sig = 0;
-          if (R_sig < 0) R_sig = 0;
+          int L_sig = sideSignal(0, line_L_offset);
+          int R_sig = sideSignal(4, line_R_offset);
           
           int L_eff = (L_sig < STEER_DEADBAND) ? 0 : L_sig;
           int R_eff = (R_sig < STEER_DEADBAND) ? 0 : R_sig;
           
-          Serial.print("IR=");
+          Serial.print(F("IR="));
           Serial.print(ir_value, 1);
-          Serial.print(" L=");
+          Serial.print(F(" L="));
           Serial.print(L_eff);
-          Serial.print(" R=");
+          Serial.print(F(" R="));
           Serial.print(R_eff);
-          Serial.print(" Diff=");
+          Serial.print(F(" Diff="));
           Serial.print(R_eff - L_eff);
-          Serial.print(" | Steer=");
+          Serial.print(F(" | Steer="));
           Serial.print(steer_filtered, 2);
-          Serial.print(" Spd=");
+          Serial.print(F(" Spd="));
           Serial.println(speed, 1);
         }
       }
@@ -241,7 +260,7 @@ void loop() {
       
       printResults();
       
-      Serial.println("\nExperiment finished. Reset to run again.");
+      Serial.println(F("\nExperiment finished. Reset to run again."));
       delay(5000);
       break;
     
@@ -280,29 +299,46 @@ void updateFollowingControl() {
   motors.setPWM((int)demand_L, (int)demand_R);
 }
 
+void readLineFrame() {
+  line_sensors.latestFrame();
+#if LINE_ADC_LOCKIN
+  line_sensors.latestLockIn();
+#endif
+}
+
+// leader 带来的信号（ADC 计数）：锁相时是 载波幅度 - 噪声底，否则是 背景 - 读数
+// background_values[] 在锁相时存的是噪声底（见 calibrateSensors()）
+float leaderSignal(int sensor) {
+#if LINE_ADC_LOCKIN
+  float s = line_sensors.amplitude[sensor] - background_values[sensor];
+#else
+  float s = background_values[sensor] - line_sensors.readings[sensor];
+#endif
+  return (s < 0) ? 0 : s;
+}
+
+// 同上，offset 是这一路 leader 关着时的水平（line_L_offset / line_R_offset）
+int sideSignal(int sensor, int offset) {
+#if LINE_ADC_LOCKIN
+  int s = (int)line_sensors.amplitude[sensor] - offset;
+#else
+  int s = offset - (int)line_sensors.readings[sensor];
+#endif
+  return (s < 0) ? 0 : s;
+}
+
 float getCenterIRValue() {
-  line_sensors.readSensorsADC();
-  
-  float ir_1 = background_values[1] - line_sensors.readings[1];
-  float ir_2 = background_values[2] - line_sensors.readings[2];
-  float ir_3 = background_values[3] - line_sensors.readings[3];
-  
-  if (ir_1 < 0) ir_1 = 0;
-  if (ir_2 < 0) ir_2 = 0;
-  if (ir_3 < 0) ir_3 = 0;
+  float ir_1 = leaderSignal(1);
+  float ir_2 = leaderSignal(2);
+  float ir_3 = leaderSignal(3);
   
   float ir_avg = (ir_1 + ir_2 + ir_3) / 3.0f;
   return ir_avg;
 }
 
 float getSteerFromLine() {
-  line_sensors.readSensorsADC();
-  
-  int L_signal = line_L_offset - (int)line_sensors.readings[0];
-  int R_signal = line_R_offset - (int)line_sensors.readings[4];
-  
-  if (L_signal < 0) L_signal = 0;
-  if (R_signal < 0) R_signal = 0;
+  int L_signal = sideSignal(0, line_L_offset);
+  int R_signal = sideSignal(4, line_R_offset);
   
   rec_L_signal = L_signal;
   rec_R_signal = R_signal;
@@ -327,55 +363,18 @@ bool hasSignal() {
 }
 
 void recordData() {
-  if (results_index < MAX_RESULTS) {
-    results[results_index][0] = kin.x;
-    results[results_index][1] = kin.y;
-    results[results_index][2] = kin.theta;
-    results[results_index][3] = spdL_cps;
-    results[results_index][4] = spdR_cps;
-    results[results_index][5] = rec_IR_center;
-    results[results_index][6] = (float)rec_L_signal;
-    results[results_index][7] = (float)rec_R_signal;
-    results[results_index][8] = rec_speed_cmd;
-    results[results_index][9] = rec_steer_cmd;
-    results_index++;
-  }
+  run_log.add(kin.x, kin.y, kin.theta, spdL_cps, spdR_cps, rec_IR_center,
+              rec_L_signal, rec_R_signal, rec_speed_cmd, rec_steer_cmd);
 }
 
+// 十六进制整块打印，用 decode_run_log.py 解成 CSV
 void printResults() {
-  Serial.println("\n========== FOLLOWER DATA (CSV) ==========");
-  Serial.println("Sample,X_mm,Y_mm,Theta_rad,SpdL_cps,SpdR_cps,IR_center,L_signal,R_signal,Speed_cmd,Steer_cmd");
-  
-  for (int i = 0; i < results_index; i++) {
-    Serial.print(i);
-    Serial.print(",");
-    Serial.print(results[i][0], 2);  
-    Serial.print(",");
-    Serial.print(results[i][1], 2);  
-    Serial.print(",");
-    Serial.print(results[i][2], 4);  
-    Serial.print(",");
-    Serial.print(results[i][3], 1);  
-    Serial.print(",");
-    Serial.print(results[i][4], 1);
-    Serial.print(",");
-    Serial.print(results[i][5], 1);
-    Serial.print(",");
-    Serial.print((int)results[i][6]);
-    Serial.print(",");
-    Serial.print((int)results[i][7]);
-    Serial.print(",");
-    Serial.print(results[i][8], 1);
-    Serial.print(",");
-    Serial.println(results[i][9], 2);
-  }
-  
-  Serial.println("==========================================");
-  Serial.print("Total samples: ");
-  Serial.println(results_index);
-  Serial.print("Record interval: ");
-  Serial.print(RECORD_INTERVAL_MS);
-  Serial.println(" ms");
+  run_log.dump(UPDATE_INTERVAL * LOG_EVERY);
+  Serial.print(F("Total samples: "));
+  Serial.println(run_log.size());
+  Serial.print(F("Record interval: "));
+  Serial.print(UPDATE_INTERVAL * LOG_EVERY);
+  Serial.println(F(" ms"));
 }
 
 void beep(int duration) {
@@ -387,19 +386,13 @@ void beep(int duration) {
 void updateWheelSpeed() {
   unsigned long now = millis();
   if (now - speed_est_ts >= SPEED_EST_MS) {
-    unsigned long dt = now - speed_est_ts;
     speed_est_ts = now;
     
-    long e0 = count_e0;
-    long e1 = count_e1;
-    long d0 = e0 - last_e0;
-    long d1 = e1 - last_e1;
-    last_e0 = e0;
-    last_e1 = e1;
-    
-    float dt_sec = (float)dt / 1000.0f;
-    spdR_cps = (float)d0 / dt_sec;
-    spdL_cps = (float)d1 / dt_sec;
+    EncoderSnapshot_t enc;
+    readEncoders(enc);
+    unsigned long now_us = micros();
+    spdR_cps = wsR.update(edges_e0, enc.e0, now_us);
+    spdL_cps = wsL.update(edges_e1, enc.e1, now_us);
   }
 }
 
@@ -409,10 +402,10 @@ void setupIRReceiver() {
 }
 
 void calibrateSensors() {
-  Serial.println("\n===== Sensor Calibration =====");
-  Serial.println("Sampling background values...");
-  Serial.println("Make sure Leader is NOT active or far away!");
-  Serial.println("");
+  Serial.println(F("\n===== Sensor Calibration ====="));
+  Serial.println(F("Sampling background values..."));
+  Serial.println(F("Make sure Leader is NOT active or far away!"));
+  Serial.println(F(""));
   
   beep(100);
   delay(2000);
@@ -423,7 +416,7 @@ void calibrateSensors() {
   long sum_L = 0;
   long sum_R = 0;
   
-  Serial.println("Sampling 30 frames...");
+  Serial.println(F("Sampling 30 frames..."));
   for (int sample = 0; sample < 30; sample++) {
     line_sensors.readSensorsADC();
     
@@ -442,20 +435,47 @@ void calibrateSensors() {
   line_L_offset = sum_L / 30;
   line_R_offset = sum_R / 30;
   
-  Serial.println("Calibration complete!");
-  Serial.println("Background values:");
+  Serial.println(F("Calibration complete!"));
+  Serial.println(F("Background values:"));
   for (int i = 0; i < NUM_SENSORS; i++) {
-    Serial.print("  Sensor[");
+    Serial.print(F("  Sensor["));
     Serial.print(i);
-    Serial.print("]: ");
+    Serial.print(F("]: "));
     Serial.println(background_values[i], 1);
   }
-  Serial.println("");
-  Serial.print("Steering offsets: L=");
+  Serial.println(F(""));
+  Serial.println(F("Noise (leader off):"));
+  line_sensors.reportSNR(100);
+#if LINE_ADC_LOCKIN
+  {
+    // 没有载波时解调出的幅度就是噪声底，要远低于 SIGNAL_THRESHOLD；
+    // 锁相时 leaderSignal() / sideSignal() 减掉的是它，不是 ADC 背景
+    float floor_amp[NUM_SENSORS];
+    for (int i = 0; i < NUM_SENSORS; i++) floor_amp[i] = 0.0f;
+    unsigned long last_seq = line_sensors.latestLockIn();
+    for (int n = 0; n < 20; n++) {
+      unsigned long seq;
+      while ((seq = line_sensors.latestLockIn()) == last_seq) {}
+      last_seq = seq;
+      for (int i = 0; i < NUM_SENSORS; i++) floor_amp[i] += line_sensors.amplitude[i] / 20.0f;
+    }
+    Serial.print(F("Lock-in floor (leader off):"));
+    for (int i = 0; i < NUM_SENSORS; i++) {
+      Serial.print(F(" "));
+      Serial.print(floor_amp[i], 1);
+    }
+    Serial.println(F(""));
+    for (int i = 0; i < NUM_SENSORS; i++) background_values[i] = floor_amp[i];
+    line_L_offset = (int)(floor_amp[0] + 0.5f);
+    line_R_offset = (int)(floor_amp[4] + 0.5f);
+  }
+#endif
+  Serial.println(F(""));
+  Serial.print(F("Steering offsets: L="));
   Serial.print(line_L_offset);
-  Serial.print(" R=");
+  Serial.print(F(" R="));
   Serial.println(line_R_offset);
-  Serial.println("");
+  Serial.println(F(""));
   
   beep(100);
   delay(200);
@@ -0,0 +1,123 @@
+#ifndef _RUNLOG_H
+#define _RUNLOG_H
+
+#include <Arduino.h>
+
+// 跑车记录：每条 20 字节的定点数，放在环形缓冲里，满了就覆盖最老的
+// 跑完整块按十六进制打印，decode_run_log.py 再解回原来的 CSV 列：
+//   Sample,X_mm,Y_mm,Theta_rad,SpdL_cps,SpdR_cps,IR_center,L_signal,R_signal,Speed_cmd,Steer_cmd
+//
+// 字段（小端，和 decode_run_log.py 里的 RECORD 对应）：
+//   x, y          int16   0.1mm    ±3.2m
+//   theta         int16   mrad
+//   spd_l, spd_r  int16   0.1cps
+//   ir_center     int16   0.1
+//   l/r_signal    int16
+//   speed_cmd     int16   0.1
+//   steer_cmd     int16   0.01     ±327（|steer| <= 0.6 * speed）
+// 超出范围的值饱和，不会绕回
+//
+// 原来 float results[15][10] 占 600 字节；这里 30 条也是 600 字节，不比原来多占 SRAM
+// （这个草图还有锁相 / ADC 的状态和边沿环形缓冲，32U4 只有 2.5KB，加大之前先看 avr-size）
+
+#define RUNLOG_VERSION 1
+
+#ifndef RUNLOG_CAPACITY
+#define RUNLOG_CAPACITY 30
+#endif
+
+struct LogRecord_t {
+  int16_t x;
+  int16_t y;
+  int16_t theta;
+  int16_t spd_l;
+  int16_t spd_r;
+  int16_t ir_center;
+  int16_t l_signal;
+  int16_t r_signal;
+  int16_t speed_cmd;
+  int16_t steer_cmd;
+} __attribute__( ( packed ) );
+
+static_assert( sizeof( LogRecord_t ) == 20, "LogRecord_t layout must match decode_run_log.py" );
+
+class RunLog_c {
+  public:
+
+    LogRecord_t rec[ RUNLOG_CAPACITY ];
+    uint16_t head;             // 下一条写在哪
+    uint16_t total;            // 一共记过几条（用来算最老一条的序号）
+
+    RunLog_c() {
+      reset();
+    }
+
+    void reset() {
+      head = 0;
+      total = 0;
+    }
+
+    uint16_t size() {
+      return ( total < RUNLOG_CAPACITY ) ? total : RUNLOG_CAPACITY;
+    }
+
+    void add( float x_mm, float y_mm, float theta, float spd_l, float spd_r, float ir_center,
+              int l_signal, int r_signal, float speed_cmd, float steer_cmd ) {
+      LogRecord_t &r = rec[ head ];
+      r.x = fix( x_mm, 10.0f );
+      r.y = fix( y_mm, 10.0f );
+      r.theta = fix( theta, 1000.0f );
+      r.spd_l = fix( spd_l, 10.0f );
+      r.spd_r = fix( spd_r, 10.0f );
+      r.ir_center = fix( ir_center, 10.0f );
+      r.l_signal = l_signal;
+      r.r_signal = r_signal;
+      r.speed_cmd = fix( speed_cmd, 10.0f );
+      r.steer_cmd = fix( steer_cmd, 100.0f );
+
+      if ( ++head >= RUNLOG_CAPACITY ) head = 0;
+      if ( total < 0xFFFF ) total++;
+    }
+
+    // 四舍五入再饱和到 int16
+    int16_t fix( float v, float scale ) {
+      float s = v * scale;
+      if ( s >= 32767.0f ) return 32767;
+      if ( s <= -32768.0f ) return -32768;
+      return (int16_t)( s + ( s >= 0.0f ? 0.5f : -0.5f ) );
+    }
+
+    // 头一行：LOG,版本,每条字节数,记录间隔ms,最老一条的序号,条数；之后每条一行十六进制
+    void dump( unsigned int interval_ms ) {
+      uint16_t n = size();
+      uint16_t first = total - n;
+      uint16_t idx = ( head + RUNLOG_CAPACITY - n ) % RUNLOG_CAPACITY;
+
+      Serial.println( F("\n========== FOLLOWER LOG (HEX) ==========") );
+      Serial.print( F("LOG,") );
+      Serial.print( RUNLOG_VERSION );
+      Serial.print( F(",") );
+      Serial.print( sizeof( LogRecord_t ) );
+      Serial.print( F(",") );
+      Serial.print( interval_ms );
+      Serial.print( F(",") );
+      Serial.print( first );
+      Serial.print( F(",") );
+      Serial.println( n );
+
+      for ( uint16_t k = 0; k < n; k++ ) {
+        const uint8_t *p = (const uint8_t *)&rec[ idx ];
+        for ( byte b = 0; b < sizeof( LogRecord_t ); b++ ) {
+          if ( p[ b ] < 0x10 ) Serial.print( F("0") );
+          Serial.print( p[ b ], HEX );
+        }
+        Serial.println();
+        if ( ++idx >= RUNLOG_CAPACITY ) idx = 0;
+      }
+
+      Serial.println( F("==========================================") );
+    }
+
+};
+
+#endif
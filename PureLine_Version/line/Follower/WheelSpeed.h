@@ -0,0 +1,105 @@
+#ifndef _WHEELSPEED_H
+#define _WHEELSPEED_H
+
+#include "Encoders.h"
+
+// 低速：用最近几个边沿的时间间隔（周期法）
+// 高速：用窗口内计数差 / dt（计数法）
+// 两者之间按窗口内边沿数线性混合
+#define SPEED_PERIOD_EDGES  4        // 周期法最多跨4个边沿（一个完整正交周期）
+#define SPEED_MIX_LO        3        // 窗口边沿数 <= LO：纯周期法
+#define SPEED_MIX_HI        8        // 窗口边沿数 >= HI：纯计数法
+#define SPEED_STOP_US       150000UL // 超过这么久没有边沿视为静止
+
+class WheelSpeed_c {
+  public:
+
+    float cps;             // 输出速度 counts/s
+
+    unsigned long hist_t[ SPEED_PERIOD_EDGES ];
+    byte hist_n;
+    byte hist_i;
+    int8_t last_dir;
+
+    long last_count;
+    unsigned long last_us;
+
+    WheelSpeed_c() {
+    }
+
+    void initialise( EdgeRing_t &ring, long count, unsigned long now_us ) {
+      unsigned long t;
+      int8_t d;
+      while ( popEdge( ring, t, d ) ) {}
+      ring.overflow = false;
+
+      cps = 0.0f;
+      hist_n = 0;
+      hist_i = 0;
+      last_dir = 0;
+      last_count = count;
+      last_us = now_us;
+    }
+
+    float update( EdgeRing_t &ring, long count, unsigned long now_us ) {
+      unsigned long t;
+      int8_t d;
+      byte n_edges = 0;
+
+      while ( popEdge( ring, t, d ) ) {
+        // 换向后旧的间隔没有意义
+        if ( d != last_dir ) {
+          hist_n = 0;
+          last_dir = d;
+        }
+        hist_t[ hist_i ] = t;
+        hist_i = ( hist_i + 1 ) % SPEED_PERIOD_EDGES;
+        if ( hist_n < SPEED_PERIOD_EDGES ) hist_n++;
+        if ( n_edges < 255 ) n_edges++;
+      }
+
+      bool lost = ring.overflow;
+      ring.overflow = false;
+
+      unsigned long dt_us = now_us - last_us;
+      float cps_count = 0.0f;
+      if ( dt_us > 0 ) {
+        cps_count = (float)( count - last_count ) * 1000000.0f / (float)dt_us;
+      }
+      last_count = count;
+      last_us = now_us;
+
+      float cps_period = 0.0f;
+      if ( hist_n >= 2 ) {
+        byte newest = ( hist_i + SPEED_PERIOD_EDGES - 1 ) % SPEED_PERIOD_EDGES;
+        byte oldest = ( hist_i + SPEED_PERIOD_EDGES - hist_n ) % SPEED_PERIOD_EDGES;
+        unsigned long period = ( hist_t[ newest ] - hist_t[ oldest ] ) / ( hist_n - 1 );
+        // now_us 是调用方在取边沿之前读的，这期间进来的边沿会比它晚：按刚有边沿算，不能让减法绕回
+        long since_raw = (long)( now_us - hist_t[ newest ] );
+        unsigned long since = ( since_raw > 0 ) ? (unsigned long)since_raw : 0;
+
+        // 还没等到下一个边沿时，速度不可能高于 1/since
+        if ( since > period ) period = since;
+
+        if ( since < SPEED_STOP_US && period > 0 ) {
+          cps_period = (float)last_dir * 1000000.0f / (float)period;
+        } else {
+          hist_n = 0;
+        }
+      }
+
+      if ( lost || n_edges >= SPEED_MIX_HI ) {
+        cps = cps_count;
+      } else if ( n_edges <= SPEED_MIX_LO ) {
+        cps = cps_period;
+      } else {
+        float w = (float)( n_edges - SPEED_MIX_LO ) / (float)( SPEED_MIX_HI - SPEED_MIX_LO );
+        cps = w * cps_count + ( 1.0f - w ) * cps_period;
+      }
+
+      return cps;
+    }
+
+};
+
+#endif
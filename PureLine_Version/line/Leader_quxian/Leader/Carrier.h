@@ -0,0 +1,161 @@
+#ifndef _CARRIER_H
+#define _CARRIER_H
+
+#include <Arduino.h>
+
+// EMIT_PIN 上的方波载波，给 follower 做锁相（同步）解调用
+// EMIT_PIN 11 = PB7：输出 HIGH 开 line 发射管，输出 LOW 开 bump 发射管，输入（不带上拉）两个都关
+//
+// begin(level)：单载波，Timer4 溢出中断每半个周期翻转一次：开 = 输出 level，关 = 输入
+// beginFdm()：频分，两组发射管各用一个载波（line 约 434Hz，bump 约 651Hz）
+//   同一个脚不能同时开两组，所以按 64us 的节拍交替：偶数拍给 bump、奇数拍给 line，
+//   各自的方波在自己的拍里开/关；follower 看到的是各自载波一半的幅度，两个载波互不干扰
+//
+// 半周期要和 follower LineSensors.h 里的 LINE_LOCKIN_HALF_PERIOD_US / LINE_LOCKIN_B_HALF_PERIOD_US 一样
+// 两个频率离 100/120Hz 灯光闪烁的各次谐波都有 30Hz 以上，互相的谐波也不会混叠到对方上（simulate_fdm.py）
+// Timer4 会被重新配置：pin 6 / pin 13 上不能再用 analogWrite()（蜂鸣器用 tone() 没问题）
+
+#ifndef CARRIER_HALF_PERIOD_US
+#define CARRIER_HALF_PERIOD_US    1152    // line，约 434Hz
+#endif
+
+#ifndef CARRIER_B_HALF_PERIOD_US
+#define CARRIER_B_HALF_PERIOD_US  768     // bump，约 651Hz（只在频分时用）
+#endif
+
+#define CARRIER_TICK_US      8            // Timer4 128 分频
+#define CARRIER_TICKS        ( CARRIER_HALF_PERIOD_US / CARRIER_TICK_US )
+#define CARRIER_FDM_TICK_US  64
+#define CARRIER_FDM_L_TICKS  ( CARRIER_HALF_PERIOD_US / CARRIER_FDM_TICK_US )
+#define CARRIER_FDM_B_TICKS  ( CARRIER_B_HALF_PERIOD_US / CARRIER_FDM_TICK_US )
+#define CARRIER_MASK         ( 1 << PORTB7 )
+
+#if CARRIER_TICKS > 256 || CARRIER_TICKS < 2
+#error "CARRIER_HALF_PERIOD_US out of range for Timer4 at 8us ticks"
+#endif
+
+#if CARRIER_HALF_PERIOD_US % CARRIER_FDM_TICK_US || CARRIER_B_HALF_PERIOD_US % CARRIER_FDM_TICK_US
+#error "carrier half periods must be whole 64us FDM ticks"
+#endif
+
+class Carrier_c {
+  public:
+
+    volatile bool level;       // 开的时候 EMIT_PIN 输出的电平
+    volatile bool on;
+    bool fdm;
+
+    // 频分状态（只在 ISR 里改）
+    byte n_b;                  // 各自半周期里还剩几拍
+    byte n_l;
+    bool on_b;
+    bool on_l;
+    bool bump_tick;
+
+    Carrier_c() {
+      level = HIGH;
+      on = false;
+      fdm = false;
+    }
+
+    // Timer4：普通模式，TOP = OCR4C，128 分频
+    void startTimer( byte top ) {
+      TIMSK4 = 0;
+      TCCR4A = 0;
+      TCCR4C = 0;
+      TCCR4D = 0;
+      TCCR4E = 0;
+      TC4H = 0;
+      OCR4C = top;
+      TCNT4 = 0;
+      TIFR4 = ( 1 << TOV4 );
+      TCCR4B = ( 1 << CS43 );
+      TIMSK4 |= ( 1 << TOIE4 );
+    }
+
+    void begin( bool emit_level ) {
+      level = emit_level;
+      on = false;
+      fdm = false;
+      emitOff();
+      startTimer( CARRIER_TICKS - 1 );
+    }
+
+    void beginFdm() {
+      on = false;
+      fdm = true;
+      n_b = CARRIER_FDM_B_TICKS;
+      n_l = CARRIER_FDM_L_TICKS;
+      on_b = true;
+      on_l = true;
+      bump_tick = true;
+      emitOff();
+      startTimer( CARRIER_FDM_TICK_US / CARRIER_TICK_US - 1 );
+    }
+
+    // 换发射管（下一次打开时生效）
+    void setLevel( bool emit_level ) {
+      level = emit_level;
+    }
+
+    // 停掉载波，EMIT_PIN 留在输入（两个都关）
+    void stop() {
+      TIMSK4 &= ~( 1 << TOIE4 );
+      on = false;
+      emitOff();
+    }
+
+    void emitOff() {
+      DDRB &= ~CARRIER_MASK;
+      PORTB &= ~CARRIER_MASK;
+    }
+
+    // 先设电平再切输出，中间不会把另一组发射管点亮
+    void emitOn() {
+      if ( level ) PORTB |= CARRIER_MASK;
+      else PORTB &= ~CARRIER_MASK;
+      DDRB |= CARRIER_MASK;
+    }
+
+    // 两组的方波各走各的，每拍只有轮到的那组能开
+    void tickFdm() {
+      if ( --n_b == 0 ) {
+        n_b = CARRIER_FDM_B_TICKS;
+        on_b = !on_b;
+      }
+      if ( --n_l == 0 ) {
+        n_l = CARRIER_FDM_L_TICKS;
+        on_l = !on_l;
+      }
+      bump_tick = !bump_tick;
+
+      bool en = bump_tick ? on_b : on_l;
+      if ( en ) {
+        level = bump_tick ? LOW : HIGH;
+        emitOn();
+      } else {
+        emitOff();
+      }
+      on = en;
+    }
+
+    // 只在 ISR 里调用
+    void tick() {
+      if ( fdm ) {
+        tickFdm();
+        return;
+      }
+      on = !on;
+      if ( on ) emitOn();
+      else emitOff();
+    }
+
+};
+
+Carrier_c carrier;
+
+ISR( TIMER4_OVF_vect ) {
+  carrier.tick();
+}
+
+#endif
@@ -5,72 +5,60 @@
 #define ENCODER_0_B_PIN  23
 #define ENCODER_1_A_PIN  26
 
+// 端口寄存器位置（3Pi+ 32U4）
+// E0: A = PE6 (XOR), B = PF0
+// E1: A = PB4 (XOR), B = PE2
+#define E0_A_BIT  PINE6
+#define E0_B_BIT  PINF0
+#define E1_A_BIT  PINB4
+#define E1_B_BIT  PINE2
+
 volatile long count_e0;
 volatile byte state_e0;
 volatile long count_e1;
 volatile byte state_e1;
 
-ISR( INT6_vect ) {
-  boolean e0_B = digitalRead( ENCODER_0_B_PIN );
-  boolean e0_A = digitalRead( ENCODER_0_A_PIN );
+// 编码器一致快照：两个计数在同一次关中断内取出
+// 32位变量在8位AVR上读取不是原子的，直接读count_e0可能读到ISR改了一半的值
+struct EncoderSnapshot_t {
+  long e0;
+  long e1;
+};
+
+// 只在拷贝8个字节期间关中断，之后恢复原来的SREG
+inline void readEncoders( EncoderSnapshot_t &snap ) {
+  byte sreg = SREG;
+  cli();
+  snap.e0 = count_e0;
+  snap.e1 = count_e1;
+  SREG = sreg;
+}
 
-  e0_A = e0_A ^ e0_B;
+// 状态 = (新B << 3) | (新A << 2) | (旧B << 1) | 旧A
+// 与原if/else链的增减一致：1,7,8,14 -> -1；2,4,11,13 -> +1；其余为0
+const int8_t enc_step_table[16] = {
+   0, -1, +1,  0,
+  +1,  0,  0, -1,
+  -1,  0,  0, +1,
+   0, +1, -1,  0
+};
 
-  state_e0 = state_e0 | ( e0_B  << 3 );
-  state_e0 = state_e0 | ( e0_A  << 2 );
-
-  if ( state_e0 == 1 ) {
-    count_e0--;
-  } else if ( state_e0 == 2) {
-    count_e0++;
-  } else if ( state_e0 == 4) {
-    count_e0++;
-  } else if ( state_e0 == 7) {
-    count_e0--;
-  } else if ( state_e0 == 8) {
-    count_e0--;
-  } else if ( state_e0 == 11) {
-    count_e0++;
-  } else if ( state_e0 == 13) {
-    count_e0++;
-  } else if ( state_e0 == 14) {
-    count_e0--;
-  }
-
-  state_e0 = state_e0 >> 2;
+ISR( INT6_vect ) {
+  byte e0_B = ( PINF >> E0_B_BIT ) & 1;
+  byte e0_A = ( ( PINE >> E0_A_BIT ) & 1 ) ^ e0_B;
 
+  byte s = state_e0 | ( e0_B << 3 ) | ( e0_A << 2 );
+  count_e0 += enc_step_table[ s ];
+  state_e0 = s >> 2;
 }
 
 ISR( PCINT0_vect ) {
+  byte e1_B = ( PINE >> E1_B_BIT ) & 1;
+  byte e1_A = ( ( PINB >> E1_A_BIT ) & 1 ) ^ e1_B;
 
-  boolean e1_B = PINE & (1 << PINE2);
-
-  boolean e1_A = digitalRead( ENCODER_1_A_PIN );
-
-  e1_A = e1_A ^ e1_B;
-
-  state_e1 = state_e1 | ( e1_B  << 3 );
-  state_e1 = state_e1 | ( e1_A  << 2 );
-
-  if ( state_e1 == 1 ) {
-    count_e1--;
-  } else if ( state_e1 == 2) {
-    count_e1++;
-  } else if ( state_e1 == 4) {
-    count_e1++;
-  } else if ( state_e1 == 7) {
-    count_e1--;
-  } else if ( state_e1 == 8) {
-    count_e1--;
-  } else if ( state_e1 == 11) {
-    count_e1++;
-  } else if ( state_e1 == 13) {
-    count_e1++;
-  } else if ( state_e1 == 14) {
-    count_e1--;
-  }
-
-  state_e1 = state_e1 >> 2;
+  byte s = state_e1 | ( e1_B << 3 ) | ( e1_A << 2 );
+  count_e1 += enc_step_table[ s ];
+  state_e1 = s >> 2;
 }
 
 void setupEncoder0()
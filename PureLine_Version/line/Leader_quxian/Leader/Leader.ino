@@ -4,6 +4,13 @@
 #include "Kinematics.h"
 #include "LineSensors.h"
 
+// 1 = EMIT_PIN 上加 434Hz 方波载波（follower 用 LINE_ADC_LOCKIN 解调），0 = 常亮
+#define LEADER_CARRIER 1
+
+#if LEADER_CARRIER
+#include "Carrier.h"
+#endif
+
 #define EMIT_PIN    11
 #define BUZZ_PIN    6
 #define BTN_PIN     14
@@ -84,9 +91,9 @@ void handleBeep() {
 }
 
 void beep(int duration) {
-  analogWrite(BUZZ_PIN, 120);
+  tone(BUZZ_PIN, 800);
   delay(duration);
-  analogWrite(BUZZ_PIN, 0);
+  noTone(BUZZ_PIN);
 }
 
 void recordData() {
@@ -119,7 +126,9 @@ void updateSpeedEstimate() {
     unsigned long dt = now - drive_est_ts;
     drive_est_ts = now;
     
-    long e0 = count_e0, e1 = count_e1;
+    EncoderSnapshot_t enc;
+    readEncoders(enc);
+    long e0 = enc.e0, e1 = enc.e1;
     long d0 = e0 - d_last_e0;
     long d1 = e1 - d_last_e1;
     d_last_e0 = e0;
@@ -210,9 +219,14 @@ void setup() {
   left_pid.reset();
   right_pid.reset();
   
+#if LEADER_CARRIER
+  carrier.begin(HIGH);
+  Serial.println("Line IR: 434Hz carrier (EMIT_PIN = HIGH / off)");
+#else
   pinMode(EMIT_PIN, OUTPUT);
   digitalWrite(EMIT_PIN, HIGH);
   Serial.println("Line IR: ON (EMIT_PIN = HIGH)");
+#endif
   
   pinMode(BUZZ_PIN, OUTPUT);
   pinMode(BTN_PIN, INPUT_PULLUP);
@@ -331,6 +345,9 @@ void loop() {
     case STATE_FINISHED:
       motors.setPWM(0, 0);
       
+#if LEADER_CARRIER
+      carrier.stop();
+#endif
       digitalWrite(EMIT_PIN, LOW);
       Serial.println("IR OFF - Follower will stop due to signal lost");
       
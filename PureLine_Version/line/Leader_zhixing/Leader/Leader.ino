@@ -4,6 +4,13 @@
 #include "Kinematics.h"
 #include "LineSensors.h"
 
+// 1 = EMIT_PIN 上加 434Hz 方波载波（follower 用 LINE_ADC_LOCKIN 解调），0 = 常亮
+#define LEADER_CARRIER 1
+
+#if LEADER_CARRIER
+#include "Carrier.h"
+#endif
+
 #define EMIT_PIN    11
 #define BUZZ_PIN    6
 
@@ -76,9 +83,9 @@ void handleBeep() {
 }
 
 void beep(int duration) {
-  analogWrite(BUZZ_PIN, 120);
+  tone(BUZZ_PIN, 800);
   delay(duration);
-  analogWrite(BUZZ_PIN, 0);
+  noTone(BUZZ_PIN);
 }
 
 void recordData() {
@@ -111,7 +118,9 @@ void updateSpeedEstimate() {
     unsigned long dt = now - drive_est_ts;
     drive_est_ts = now;
     
-    long e0 = count_e0, e1 = count_e1;
+    EncoderSnapshot_t enc;
+    readEncoders(enc);
+    long e0 = enc.e0, e1 = enc.e1;
     long d0 = e0 - d_last_e0;
     long d1 = e1 - d_last_e1;
     d_last_e0 = e0;
@@ -168,9 +177,14 @@ void setup() {
   left_pid.reset();
   right_pid.reset();
   
+#if LEADER_CARRIER
+  carrier.begin(HIGH);
+  Serial.println("Line IR: 434Hz carrier (EMIT_PIN = HIGH / off)");
+#else
   pinMode(EMIT_PIN, OUTPUT);
   digitalWrite(EMIT_PIN, HIGH);
   Serial.println("Line IR: ON (EMIT_PIN = HIGH)");
+#endif
   
   pinMode(BUZZ_PIN, OUTPUT);
   
@@ -0,0 +1,199 @@
+"""
+里程计参数标定工具（UMBmark 方形 / 圆弧测试）
+
+用若干次跑车的原始编码器记录 + 实测终点位姿，最小二乘拟合
+左右轮半径和轮距，并生成草图可直接使用的 RobotProfile.h。
+Kinematics.h 会在草图目录里发现 RobotProfile.h 时自动使用其中的参数。
+
+每次跑车的 CSV 需要包含累计编码器计数列（任选一种命名）：
+    e0,e1   或   Count_e0,Count_e1
+e0 为右轮，e1 为左轮（与 Follower.ino 一致）。
+
+记录的来源：Follower.ino 打开 ODOMETRY_LOG（见 Follower/OdometryLog.h），跑完按键停车，
+串口会打印一段
+    e0,e1
+    <累计计数>...
+    ODOLOG_END
+串口监视器的输出整段存成文件直接当 CSV 给（带 "12:34:56.789 -> " 时间戳的也行，
+e0,e1 之前和 ODOLOG_END 之后的其他输出都会跳过）。看到 ODOLOG_FULL 说明记满了，
+记满之后车还在走，这一次不能用，把 ODOLOG_EVERY 调大再跑。
+
+终点位姿在车起点坐标系下测量：x 向前、y 向左（mm），theta 逆时针（度）。
+方形测试一般顺/逆时针各跑几次；只跑闭合路径时无法确定整体尺度，
+所以最好再加一条已知长度的直线（例如 --run line.csv 1000 0 0）。
+
+用法：
+    python calibrate_odometry.py --run cw1.csv 12 -30 3.5 --run ccw1.csv -8 25 -2 \\
+        --run line.csv 998 4 0.5 --out Follower/RobotProfile.h --name FOLLOWER
+    Leader 的默认轮径/轮距不一样，先验要跟着改：--radius 17.475 --sep 44.48
+"""
+
+import argparse
+import io
+import math
+import os
+import re
+import sys
+
+import numpy as np
+import pandas as pd
+
+COUNT_PER_REV = 358.3
+
+# 先验值（与 Follower/Kinematics.h 默认值一致），只作为弱约束
+DEFAULT_RADIUS = 16.63
+DEFAULT_SEP = 43.15
+
+SIGMA_XY_MM = 2.0          # 终点位置测量误差
+SIGMA_TH_RAD = math.radians(1.0)
+SIGMA_PRIOR = np.array([0.5, 0.5, 2.0])   # rL, rR, sep
+
+
+def read_log(path):
+    """普通 CSV 直接读；串口输出（ODOMETRY_LOG）只取 e0,e1 到 ODOLOG_END 之间"""
+    with open(path, 'r', encoding='utf-8', errors='ignore') as f:
+        lines = [re.sub(r'^\s*\d{2}:\d{2}:\d{2}\.\d{3}\s*->\s*', '', l).strip() for l in f]
+    if 'ODOLOG_FULL' in lines:
+        print(f"⚠ {path}: ODOLOG_FULL，记录在停车之前就满了，终点对不上")
+    if 'e0,e1' not in lines:
+        return pd.read_csv(path)
+    start = lines.index('e0,e1')
+    rows = []
+    for l in lines[start + 1:]:
+        if not re.fullmatch(r'-?\d+,-?\d+', l):
+            break
+        rows.append(l)
+    return pd.read_csv(io.StringIO('\n'.join(['e0,e1'] + rows)))
+
+
+def load_counts(path):
+    """读取一次跑车的累计计数，返回每步增量 (d0, d1)"""
+    df = read_log(path)
+    for c0, c1 in (('e0', 'e1'), ('Count_e0', 'Count_e1')):
+        if c0 in df.columns and c1 in df.columns:
+            e0 = df[c0].to_numpy(dtype=float)
+            e1 = df[c1].to_numpy(dtype=float)
+            return np.diff(e0, prepend=e0[0]), np.diff(e1, prepend=e1[0])
+    raise ValueError(f"{path}: 找不到 e0/e1 或 Count_e0/Count_e1 列")
+
+
+def integrate(d0, d1, params):
+    """与固件 KIN_ARC 相同的里程计积分，返回终点 (x, y, theta)"""
+    r_l, r_r, sep = params
+    mpc_l = 2.0 * math.pi * r_l / COUNT_PER_REV
+    mpc_r = 2.0 * math.pi * r_r / COUNT_PER_REV
+
+    dist = (d0 * mpc_r + d1 * mpc_l) / 2.0
+    dth = (d0 * mpc_r - d1 * mpc_l) / (2.0 * sep)
+
+    theta = np.concatenate(([0.0], np.cumsum(dth)[:-1]))
+    heading = theta + dth / 2.0
+    h = dth / 2.0
+    chord = np.where(np.abs(h) > 1e-9, np.sin(h) / np.where(h == 0, 1, h), 1.0)
+
+    x = np.sum(dist * chord * np.cos(heading))
+    y = np.sum(dist * chord * np.sin(heading))
+    return x, y, float(np.sum(dth))
+
+
+def wrap(a):
+    return (a + math.pi) % (2.0 * math.pi) - math.pi
+
+
+def residuals(params, runs, prior):
+    res = []
+    for d0, d1, truth in runs:
+        x, y, th = integrate(d0, d1, params)
+        res.append((x - truth[0]) / SIGMA_XY_MM)
+        res.append((y - truth[1]) / SIGMA_XY_MM)
+        res.append(wrap(th - truth[2]) / SIGMA_TH_RAD)
+    res.extend((params - prior) / SIGMA_PRIOR)
+    return np.array(res)
+
+
+def fit(runs, prior, iterations=50):
+    """Levenberg-Marquardt，数值雅可比"""
+    p = prior.copy()
+    lam = 1e-3
+    r = residuals(p, runs, prior)
+    cost = r @ r
+    for _ in range(iterations):
+        J = np.zeros((len(r), len(p)))
+        for j in range(len(p)):
+            step = 1e-6 * max(1.0, abs(p[j]))
+            dp = p.copy()
+            dp[j] += step
+            J[:, j] = (residuals(dp, runs, prior) - r) / step
+        A = J.T @ J
+        g = J.T @ r
+        delta = np.linalg.solve(A + lam * np.diag(np.diag(A)), -g)
+        p_new = p + delta
+        r_new = residuals(p_new, runs, prior)
+        cost_new = r_new @ r_new
+        if cost_new < cost:
+            p, r, cost = p_new, r_new, cost_new
+            lam *= 0.3
+            if np.max(np.abs(delta)) < 1e-7:
+                break
+        else:
+            lam *= 10.0
+    cov = np.linalg.inv(J.T @ J)
+    return p, np.sqrt(np.diag(cov)), cost
+
+
+def write_header(path, name, params, sigma, n_runs):
+    r_l, r_r, sep = params
+    guard = '_ROBOTPROFILE_H'
+    with open(path, 'w', encoding='utf-8', newline='\n') as f:
+        f.write(f"#ifndef {guard}\n#define {guard}\n\n")
+        f.write(f"// 由 calibrate_odometry.py 生成，请勿手改（{name}，{n_runs} 次跑车）\n")
+        f.write(f"// 1σ: rL ±{sigma[0]:.3f} mm, rR ±{sigma[1]:.3f} mm, sep ±{sigma[2]:.3f} mm\n\n")
+        f.write(f"#define ROBOT_WHEEL_RADIUS_L {r_l:.4f}\n")
+        f.write(f"#define ROBOT_WHEEL_RADIUS_R {r_r:.4f}\n")
+        f.write(f"#define ROBOT_WHEEL_SEP      {sep:.4f}\n\n")
+        f.write("#endif\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='里程计参数最小二乘标定')
+    parser.add_argument('--run', nargs=4, action='append', required=True,
+                        metavar=('CSV', 'X_MM', 'Y_MM', 'THETA_DEG'),
+                        help='一次跑车的编码器记录和实测终点位姿')
+    parser.add_argument('--radius', type=float, default=DEFAULT_RADIUS, help='轮半径先验 (mm)')
+    parser.add_argument('--sep', type=float, default=DEFAULT_SEP, help='轮距先验 (mm，中心到轮)')
+    parser.add_argument('--out', default='RobotProfile.h', help='输出头文件路径')
+    parser.add_argument('--name', default='ROBOT', help='写进头文件注释的机器人名字')
+    args = parser.parse_args()
+
+    runs = []
+    for csv_file, x, y, th in args.run:
+        d0, d1 = load_counts(csv_file)
+        runs.append((d0, d1, (float(x), float(y), math.radians(float(th)))))
+        print(f"✓ {csv_file}: {len(d0)} 个采样, e0 共 {int(d0.sum())}, e1 共 {int(d1.sum())}")
+
+    prior = np.array([args.radius, args.radius, args.sep])
+    params, sigma, cost = fit(runs, prior)
+
+    print("\n" + "=" * 60)
+    print(f"{'':10s}{'先验':>12s}{'拟合':>12s}{'1σ':>10s}")
+    for label, p0, p, s in zip(('rL (mm)', 'rR (mm)', 'sep (mm)'), prior, params, sigma):
+        print(f"{label:10s}{p0:12.4f}{p:12.4f}{s:10.4f}")
+    print("=" * 60)
+
+    print("\n每次跑车的终点误差 (先验 -> 拟合):")
+    for (d0, d1, truth), (csv_file, *_ ) in zip(runs, args.run):
+        before = integrate(d0, d1, prior)
+        after = integrate(d0, d1, params)
+        eb = math.hypot(before[0] - truth[0], before[1] - truth[1])
+        ea = math.hypot(after[0] - truth[0], after[1] - truth[1])
+        print(f"  {os.path.basename(csv_file):20s} {eb:8.1f} mm -> {ea:8.1f} mm")
+
+    write_header(args.out, args.name, params, sigma, len(runs))
+    print(f"\n✓ 已写入 {args.out}")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
@@ -0,0 +1,358 @@
+"""
+编码器解码查表 和 原来 digitalRead + if/else 链 的等价性检查（改 Encoders.h 以后在电脑上跑一遍）
+
+1. 从仓库里每一份 Encoders.h（杂杂杂杂杂杂杂/ 里的旧存档除外）解析出 enc_step_table[16]，
+   16 个状态逐个和原来的链比：1,7,8,14 -> -1；2,4,11,13 -> +1；其余 0
+2. 引脚映射：两种写法都从同一组端口字节（PINB / PINE / PINF ...）里读
+   - 原来：digitalRead( ENCODER_x_PIN ) 按 32U4 的 Arduino 引脚表找到端口和位，E1 的 B 是 PINE & (1 << PINE2)
+   - 现在：中断函数体里的 ( PINx >> Ex_y_BIT ) & 1，寄存器按代码里写的，位号按 Ex_y_BIT 的定义
+   接线按原来的写法（车上一直是对的）：XOR 脚 = A ^ B，B 脚 = B。其余位每次随机，
+   E0 / E1 又有脚在同一个 PINE 里，位号写错、寄存器写错、两个轮子串了都会对不上
+3. 回放：两个轮子的边沿交错着来，每次 XOR 脚变化（= INT6 / PCINT4 触发）两种写法各跑一遍，逐个中断比较计数和状态
+   - 默认：用记录下来的跑车数据（Final/数据 下各组 CSV 的 SpdL_cps -> E1、SpdR_cps -> E0）生成边沿，
+     掺进毛刺（A/B 抖一下又回来）、没有变化的多余中断、以及两位同时变（漏掉一个边沿）的非法跳变；
+     还要和生成时的真实步数对上
+   - --pins：车上录的引脚序列（Follower.ino 打开 ENCODERS_PIN_LOG，串口输出存成文件），原样回放端口字节
+
+CPU 周期数要在车上量：Follower.ino 打开 ENCODERS_BENCHMARK，串口会输出原来的写法和现在的中断函数体
+（有边沿：计数 + micros() + pushEdge；没边沿：查表得 0）每次的 us 和周期数。
+
+用法：
+    python check_encoder_decoder.py
+    python check_encoder_decoder.py Final/数据/MIX --interval-ms 100 --glitch 0.05
+    python check_encoder_decoder.py --pins enc_pins.txt
+"""
+
+import argparse
+import glob
+import os
+import re
+import sys
+
+import numpy as np
+import pandas as pd
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+ARCHIVE = '杂杂杂杂杂杂杂'
+
+# 格雷码顺序的 (A, B)，往前走一步计数 +1
+GRAY = [(0, 0), (1, 0), (1, 1), (0, 1)]
+
+# 32U4 的 Arduino digital pin -> (端口, 位)，和 Leonardo / Pololu A-Star 32U4 的 pins_arduino.h 一样
+ARDUINO_PINS = {
+    0: ('D', 2), 1: ('D', 3), 2: ('D', 1), 3: ('D', 0), 4: ('D', 4), 5: ('C', 6), 6: ('D', 7), 7: ('E', 6),
+    8: ('B', 4), 9: ('B', 5), 10: ('B', 6), 11: ('B', 7), 12: ('D', 6), 13: ('C', 7),
+    14: ('B', 3), 15: ('B', 1), 16: ('B', 2), 17: ('B', 0),
+    18: ('F', 7), 19: ('F', 6), 20: ('F', 5), 21: ('F', 4), 22: ('F', 1), 23: ('F', 0),
+    24: ('D', 4), 25: ('D', 7), 26: ('B', 4), 27: ('B', 5), 28: ('B', 6), 29: ('D', 6), 30: ('D', 5),
+}
+PORTS = 'BCDEF'
+
+
+def chain_step(state):
+    """原来 ISR 里的 if/else 链"""
+    if state in (1, 7, 8, 14):
+        return -1
+    if state in (2, 4, 11, 13):
+        return 1
+    return 0
+
+
+def parse_table(text):
+    m = re.search(r'enc_step_table\s*\[\s*16\s*\]\s*=\s*\{([^}]*)\}', text)
+    if not m:
+        return None
+    return [int(v) for v in m.group(1).replace('+', '').split(',') if v.strip()]
+
+
+def parse_wiring(text):
+    """返回 {'old': {(轮, 'A'/'B'): (端口, 位)}, 'new': {...}}，找不到返回 None"""
+    pins = {k: int(v) for k, v in re.findall(r'#define\s+(ENCODER_\d_[AB]_PIN)\s+(\d+)', text)}
+    bits = {k: int(v) for k, v in re.findall(r'#define\s+(E\d_[AB]_BIT)\s+PIN[A-F](\d)', text)}
+    m_e1b = re.search(r'e1_B\s*=\s*PIN([A-F])\s*&\s*\(\s*1\s*<<\s*PIN[A-F](\d)\s*\)', text)
+    try:
+        old = {
+            (0, 'A'): ARDUINO_PINS[pins['ENCODER_0_A_PIN']],
+            (0, 'B'): ARDUINO_PINS[pins['ENCODER_0_B_PIN']],
+            (1, 'A'): ARDUINO_PINS[pins['ENCODER_1_A_PIN']],
+            (1, 'B'): (m_e1b.group(1), int(m_e1b.group(2))),
+        }
+    except (KeyError, AttributeError):
+        return None
+    new = {}
+    for w in (0, 1):
+        # 第一处就是中断函数体（ENCODERS_BENCHMARK 在它后面）
+        mb = re.search(rf'e{w}_B\s*=\s*\(\s*PIN([A-F])\s*>>\s*(E{w}_B_BIT)\s*\)\s*&\s*1\s*;', text)
+        ma = re.search(rf'e{w}_A\s*=\s*\(\s*\(\s*PIN([A-F])\s*>>\s*(E{w}_A_BIT)\s*\)\s*&\s*1\s*\)\s*\^\s*e{w}_B\s*;', text)
+        if not mb or not ma or mb.group(2) not in bits or ma.group(2) not in bits:
+            return None
+        new[(w, 'B')] = (mb.group(1), bits[mb.group(2)])
+        new[(w, 'A')] = (ma.group(1), bits[ma.group(2)])
+    return {'old': old, 'new': new}
+
+
+def encoder_files():
+    return sorted(p for p in glob.glob(os.path.join(ROOT, '**', 'Encoders.h'), recursive=True)
+                  if ARCHIVE not in p)
+
+
+def read_text(path):
+    with open(path, 'r', encoding='utf-8', errors='ignore') as f:
+        return f.read()
+
+
+def check_tables(paths):
+    ok = True
+    for path in paths:
+        rel = os.path.relpath(path, ROOT)
+        table = parse_table(read_text(path))
+        if table is None:
+            print(f"✗ {rel}: 找不到 enc_step_table")
+            ok = False
+            continue
+        bad = [s for s in range(16) if table[s] != chain_step(s)]
+        if len(table) != 16 or bad:
+            print(f"✗ {rel}: 状态 {bad} 和 if/else 链不一致")
+            ok = False
+        else:
+            print(f"✓ {rel}")
+    return ok
+
+
+class Decoder:
+    """一个轮子的一种写法：从端口字节里读 A / B，拼状态，算增量"""
+
+    def __init__(self, wheel, mapping, step):
+        self.a = mapping[(wheel, 'A')]
+        self.b = mapping[(wheel, 'B')]
+        self.step = step
+        self.state = 0
+        self.count = 0
+
+    def pins(self, ports):
+        b = (ports[self.b[0]] >> self.b[1]) & 1
+        a = ((ports[self.a[0]] >> self.a[1]) & 1) ^ b
+        return a, b
+
+    def setup(self, ports):
+        a, b = self.pins(ports)
+        self.state = (b << 1) | a
+
+    def isr(self, ports):
+        a, b = self.pins(ports)
+        s = self.state | (b << 3) | (a << 2)
+        self.count += self.step(s)
+        self.state = s >> 2
+
+
+class Bench:
+    """两种写法 × 两个轮子吃同一串端口字节"""
+
+    def __init__(self, wiring, table):
+        self.wiring = wiring
+        self.old = [Decoder(w, wiring['old'], chain_step) for w in (0, 1)]
+        self.new = [Decoder(w, wiring['new'], lambda s: table[s]) for w in (0, 1)]
+        self.n_isr = 0
+
+    def xor_pin(self, wheel):
+        return self.wiring['old'][(wheel, 'A')]
+
+    def setup(self, ports):
+        for d in self.old + self.new:
+            d.setup(ports)
+
+    def isr(self, wheel, ports):
+        """返回 True = 两种写法一致"""
+        self.n_isr += 1
+        old, new = self.old[wheel], self.new[wheel]
+        old.isr(ports)
+        new.isr(ports)
+        return old.count == new.count and old.state == new.state
+
+
+def pin_sequence(cps, interval_ms, glitch, rng):
+    """按每个采样间隔的轮速生成一个轮子依次的 (A, B) 和到这一步为止应有的计数"""
+    pos = 0
+    true_count = 0
+    seq = []
+    carry = 0.0
+    for v in cps:
+        carry += v * interval_ms / 1000.0
+        n = int(carry)
+        carry -= n
+        d = 1 if n >= 0 else -1
+        for _ in range(abs(n)):
+            r = rng.random()
+            if r < glitch / 3:
+                # 毛刺：往反方向抖一下再回来，净计数不变
+                seq.append((GRAY[(pos - d) % 4], true_count - d))
+                seq.append((GRAY[pos % 4], true_count))
+            elif r < 2 * glitch / 3:
+                # 引脚没变也进了中断
+                seq.append((GRAY[pos % 4], true_count))
+            elif r < glitch:
+                # 两位同时变：两种解码都记 0，之后的状态也一样
+                pos += 2 * d
+                seq.append((GRAY[pos % 4], true_count))
+                continue
+            pos += d
+            true_count += d
+            seq.append((GRAY[pos % 4], true_count))
+    return seq
+
+
+def replay_synthetic(bench, seqs, rng):
+    """两个轮子的序列随机交错，每一项先改端口字节（其余位随机）再进那个轮子的中断"""
+    wiring = bench.wiring['old']
+    used = {wiring[k] for k in wiring}
+    ports = {p: int(rng.integers(256)) for p in PORTS}
+
+    def set_wheel(w, a, b):
+        for pin, v in ((wiring[(w, 'A')], a ^ b), (wiring[(w, 'B')], b)):
+            ports[pin[0]] = (ports[pin[0]] & ~(1 << pin[1])) | (v << pin[1])
+
+    for w in (0, 1):
+        set_wheel(w, 0, 0)
+    bench.setup(ports)
+
+    idx = [0, 0]
+    while idx[0] < len(seqs[0]) or idx[1] < len(seqs[1]):
+        left = [len(seqs[w]) - idx[w] for w in (0, 1)]
+        w = 0 if rng.random() * (left[0] + left[1]) < left[0] else 1
+        (a, b), true_count = seqs[w][idx[w]]
+        idx[w] += 1
+        # 不是编码器的位随便变
+        for p in PORTS:
+            noise = int(rng.integers(256))
+            keep = sum(1 << bit for port, bit in used if port == p)
+            ports[p] = (ports[p] & keep) | (noise & ~keep)
+        set_wheel(w, a, b)
+        if not bench.isr(w, ports):
+            return f"第 {bench.n_isr} 次中断（E{w}）后 链={bench.old[w].count} 表={bench.new[w].count}"
+        if bench.new[w].count != true_count:
+            return f"第 {bench.n_isr} 次中断（E{w}）后计数 {bench.new[w].count}，应为 {true_count}"
+    return None
+
+
+def read_pin_log(path):
+    """ENCODERS_PIN_LOG 的串口输出：'PINB,PINE,PINF' 之后每行三个十六进制字节"""
+    rows = []
+    for line in read_text(path).splitlines():
+        m = re.fullmatch(r'\s*([0-9A-Fa-f]{1,2}),([0-9A-Fa-f]{1,2}),([0-9A-Fa-f]{1,2})\s*', line)
+        if m:
+            rows.append({'B': int(m.group(1), 16), 'E': int(m.group(2), 16), 'F': int(m.group(3), 16),
+                         'C': 0, 'D': 0})
+    return rows
+
+
+def replay_recorded(bench, rows):
+    """第一条是初始状态；之后哪个轮子的 XOR 脚变了就进哪个轮子的中断（两个都变就都进）"""
+    bench.setup(rows[0])
+    prev = rows[0]
+    for ports in rows[1:]:
+        for w in (0, 1):
+            port, bit = bench.xor_pin(w)
+            if (ports[port] ^ prev[port]) >> bit & 1:
+                if not bench.isr(w, ports):
+                    return f"第 {bench.n_isr} 次中断（E{w}）后 链={bench.old[w].count} 表={bench.new[w].count}"
+        prev = ports
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description='编码器查表解码和原 digitalRead + if/else 链的等价性检查')
+    parser.add_argument('data', nargs='?', default=os.path.join(ROOT, 'Final', '数据'),
+                        help='跑车 CSV 所在目录（递归查找，含 SpdL_cps / SpdR_cps 列）')
+    parser.add_argument('--interval-ms', type=float, default=100.0, help='CSV 相邻采样的时间间隔 (ms)')
+    parser.add_argument('--glitch', type=float, default=0.05, help='每一步掺入异常跳变的概率')
+    parser.add_argument('--pins', default=None, help='ENCODERS_PIN_LOG 录下的串口输出，原样回放')
+    parser.add_argument('--seed', type=int, default=0)
+    args = parser.parse_args()
+
+    paths = encoder_files()
+    print("== 各份 Encoders.h 的查表 ==")
+    ok = check_tables(paths)
+
+    print("\n== 各份 Encoders.h 的引脚映射 ==")
+    wirings = {}
+    for path in paths:
+        rel = os.path.relpath(path, ROOT)
+        text = read_text(path)
+        wiring = parse_wiring(text)
+        if wiring is None:
+            print(f"✗ {rel}: 解析不出两种写法读的引脚")
+            ok = False
+            continue
+        wirings[rel] = (wiring, parse_table(text))
+        desc = ', '.join(f"E{w}{c}=P{wiring['new'][(w, c)][0]}{wiring['new'][(w, c)][1]}"
+                         for w in (0, 1) for c in 'AB')
+        same = wiring['old'] == wiring['new']
+        print(f"{'✓' if same else '✗'} {rel}: {desc}")
+        # 映射不一样也照样回放，看看错在哪一次中断
+
+    print("\n== 跑车数据生成的边沿回放 ==")
+    files = sorted(glob.glob(os.path.join(args.data, '**', '*.csv'), recursive=True))
+    runs = []
+    for path in files:
+        try:
+            df = pd.read_csv(path)
+        except pd.errors.EmptyDataError:
+            continue
+        if 'SpdL_cps' not in df.columns or 'SpdR_cps' not in df.columns:
+            continue
+        runs.append((path, df['SpdR_cps'].to_numpy(dtype=float), df['SpdL_cps'].to_numpy(dtype=float)))
+    if not runs:
+        print(f"⚠ {args.data} 下没有带 SpdL_cps / SpdR_cps 的 CSV")
+    for rel, (wiring, table) in wirings.items():
+        rng = np.random.default_rng(args.seed)
+        n_isr = 0
+        bad = None
+        for path, e0_cps, e1_cps in runs:
+            # 正反转都要覆盖：每条记录再倒着放一遍
+            seqs = [pin_sequence(np.concatenate((c, -c[::-1])), args.interval_ms, args.glitch, rng)
+                    for c in (e0_cps, e1_cps)]
+            bench = Bench(wiring, table)
+            err = replay_synthetic(bench, seqs, rng)
+            n_isr += bench.n_isr
+            if err:
+                bad = f"{os.path.relpath(path, ROOT)}: {err}"
+                break
+        if bad:
+            ok = False
+            print(f"✗ {rel}: {bad}")
+        elif runs:
+            print(f"✓ {rel}: {len(runs)} 组记录，{n_isr} 次中断，计数和状态逐个一致，和真实步数一致")
+
+    print("\n== 车上录的引脚序列 ==")
+    if args.pins is None:
+        print("⚠ 没给 --pins：只回放了由轮速生成的边沿。车上打开 ENCODERS_PIN_LOG 录一段再跑")
+    else:
+        rows = read_pin_log(args.pins)
+        if len(rows) < 2:
+            print(f"✗ {args.pins} 里没有 'PINB,PINE,PINF' 格式的记录")
+            ok = False
+        for rel, (wiring, table) in wirings.items():
+            if len(rows) < 2:
+                break
+            bench = Bench(wiring, table)
+            err = replay_recorded(bench, rows)
+            if err:
+                ok = False
+                print(f"✗ {rel}: {err}")
+            else:
+                print(f"✓ {rel}: {len(rows)} 条记录，{bench.n_isr} 次中断，"
+                      f"E0 = {bench.new[0].count}，E1 = {bench.new[1].count}，两种写法一致")
+
+    print()
+    if ok:
+        print(f"✓ {len(paths)} 份 Encoders.h 的端口读法 + 查表和原来的 digitalRead + if/else 链等价")
+    else:
+        print("✗ 有不一致，见上面")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
@@ -0,0 +1,104 @@
+"""
+编码器计数读取的边沿注入测试（readEncoders() 快照 vs 直接读 count_e0 / count_e1）
+
+8 位 AVR 上读一个 long 是 4 条单字节 lds（低字节在前），读到一半编码器中断进来改了计数，
+拿到的就是新旧两个值各一半拼起来的数。这里按这个指令顺序在电脑上模拟：
+  - 两个轮子的计数按一串编码器边沿变化（随机正反转，一半的读取放在 0x..FF / 0x..00 这种会进位的地方）
+  - 主循环每次读两个计数，共 8 个字节；随机选一个字节之前注入一个边沿
+  - 直接读：中断马上执行，后面的字节读到新值
+  - readEncoders()：cli 之后中断挂起，等 SREG 恢复后才执行，8 个字节都是同一时刻的值
+每次读出的值必须等于读之前或之后某一时刻的真实计数，否则算撕裂；
+撕裂的读数离真实值差多少，Kinematics 那一次 update 的增量就错多少个计数。
+
+用法：
+    python check_encoder_snapshot.py
+    python check_encoder_snapshot.py --edges 20000 --seed 1
+"""
+
+import argparse
+import sys
+
+import numpy as np
+
+
+def to_bytes(v):
+    """long 的 4 个字节（小端），负数按补码"""
+    return list((v & 0xFFFFFFFF).to_bytes(4, 'little'))
+
+
+def from_bytes(b):
+    v = int.from_bytes(bytes(b), 'little')
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def read_pair(counts, edge, at, atomic):
+    """读 (e0, e1)：在第 at 个字节之前来一个边沿（at 取 0..8，8 表示读完以后才来）"""
+    out = []
+    pending = edge
+    for k in range(8):
+        if k == at and pending is not None and not atomic:
+            wheel, step = pending
+            counts[wheel] += step
+            pending = None
+        out.append(to_bytes(counts[k // 4])[k % 4])
+    # 快照：SREG 恢复以后挂起的中断才执行
+    if pending is not None:
+        wheel, step = pending
+        counts[wheel] += step
+    return from_bytes(out[:4]), from_bytes(out[4:])
+
+
+def run(edges, atomic, rng):
+    counts = [0, 0]
+    torn = 0
+    worst = 0
+    for _ in range(edges):
+        wheel = int(rng.integers(2))
+        # 一半的读取放在字节进位 / 过零的边上，撕裂只会发生在那里
+        if rng.random() < 0.5:
+            counts[wheel] = int(rng.integers(-4, 4)) * 256 + (0 if rng.random() < 0.5 else 255)
+        step = 1 if rng.random() < 0.7 else -1
+        at = int(rng.integers(9))
+        before = tuple(counts)
+        e0, e1 = read_pair(counts, (wheel, step), at, atomic)
+        after = tuple(counts)
+        # 合法的读数：两个都是读之前的值，或者来边沿那一路已经是之后的值
+        ok = (e0, e1) in (before, after) or (e0, e1) == (after[0], before[1]) or (e0, e1) == (before[0], after[1])
+        if not ok:
+            torn += 1
+        # Kinematics 用 本次读数 - 上次读数 做增量：撕裂的读数让这一次 update 多走 / 少走这么多计数
+        if not ok:
+            for i, v in enumerate((e0, e1)):
+                worst = max(worst, min(abs(v - before[i]), abs(v - after[i])))
+    return torn, worst
+
+
+def main():
+    parser = argparse.ArgumentParser(description='编码器计数快照的边沿注入测试')
+    parser.add_argument('--edges', type=int, default=100000, help='注入多少个边沿')
+    parser.add_argument('--seed', type=int, default=0)
+    args = parser.parse_args()
+
+    print(f"{args.edges} 次读取，每次在 8 个字节中随机一处注入一个编码器边沿")
+    print(f"{'读法':>14s}{'撕裂次数':>10s}{'最大计数误差':>14s}")
+    results = {}
+    for name, atomic in (('直接读', False), ('readEncoders', True)):
+        torn, worst = run(args.edges, atomic, np.random.default_rng(args.seed))
+        results[name] = torn
+        print(f"{name:>14s}{torn:>10d}{worst:>14d}")
+
+    print()
+    if results['readEncoders'] == 0:
+        print("✓ readEncoders() 的快照没有撕裂")
+    else:
+        print("✗ readEncoders() 的快照出现撕裂")
+        sys.exit(1)
+    if results['直接读'] == 0:
+        print("⚠ 直接读也没有撕裂：注入点没有覆盖到进位，检查 --edges")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
@@ -0,0 +1,181 @@
+"""
+IrMap.h 查找表的误差检查：编译期生成的表 + lookup() 的整数插值，对照原来的浮点 sigmoid
+
+按固件的做法在电脑上重算一遍：
+  - 表：irMapEntry() 逐行移植，avr-gcc 上 double 就是 float，所以用 float32 算
+    （泰勒级数到 x^7/7!、缩小 2^8 倍再平方 8 次、+0.5 截断）；顺便和 float64 / 真正的 exp 生成的表对比
+  - lookup()：raw <= IRMAP_MIN_RAW 取 0，超出表尾取最后一个点，中间 16 位整数插值，舍入和固件一样
+  - 参照：v = V_MAX / ( 1 + exp( -( raw - C ) / K ) )，raw <= IRMAP_MIN_RAW 时为 0（float64）
+常数从 IrMap.h 里解析，C / K / V_MAX 从两个 Follower.ino 的 typedef IrMap_c<...> IrMapCS 里解析。
+
+对每组参数输出：表长 / 字节数、最大误差和出现的读数、表是否单调、
+和 float64 生成的表有几个点不一样、lookup() 里 ( b - a ) * f 的最大值（AVR 上是 16 位 int）。
+
+用法：
+    python check_irmap.py
+    python check_irmap.py --max-err 0.15 --raw-max 5000
+"""
+
+import argparse
+import math
+import os
+import re
+import sys
+
+import numpy as np
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+SKETCHES = [
+    os.path.join('Follower', 'Follower.ino'),
+    os.path.join('PureLine_Version', 'bump_line', 'Follower', 'Follower.ino'),
+]
+
+F32 = np.float32
+
+
+def read_defines(path, names):
+    """#define NAME 数字"""
+    with open(path, 'r', encoding='utf-8', errors='ignore') as f:
+        text = f.read()
+    out = {}
+    for name in names:
+        m = re.search(rf'#define\s+{name}\s+(\d+)', text)
+        if not m:
+            raise ValueError(f"{path}: 找不到 {name}")
+        out[name] = int(m.group(1))
+    return out
+
+
+def read_params(path):
+    """typedef IrMap_c<C, K, V_MAX> IrMapCS;"""
+    with open(path, 'r', encoding='utf-8', errors='ignore') as f:
+        text = f.read()
+    m = re.search(r'typedef\s+IrMap_c\s*<\s*(\d+)\s*,\s*(\d+)\s*,\s*(\d+)\s*>\s*IrMapCS', text)
+    if not m:
+        raise ValueError(f"{path}: 找不到 typedef IrMap_c<...> IrMapCS")
+    return tuple(int(v) for v in m.groups())
+
+
+def exp_avr(x):
+    """irMapExp()：float32，x / 256 的级数到 i = 7，再平方 8 次"""
+    x = F32(x) / F32(256.0)
+    # irMapExpSeries 是从 term = 1 开始往里递归，加法从最里层往外做
+    terms = [F32(1.0)]
+    for i in range(1, 8):
+        terms.append(F32(terms[-1] * x / F32(i)))
+    s = terms[-1]
+    for t in reversed(terms[:-1]):
+        s = F32(t + s)
+    for _ in range(8):
+        s = F32(s * s)
+    return s
+
+
+def make_table(c, k, v_max, d, exact_exp=False):
+    """irMapEntry( C, K, V_MAX, i )，i = 0..N-1"""
+    n = (c + d['IRMAP_TAIL_K'] * k - d['IRMAP_MIN_RAW'] + d['IRMAP_STEP_US'] - 1) // d['IRMAP_STEP_US'] + 1
+    scale = 1 << d['IRMAP_FRAC_BITS']
+    table = []
+    for i in range(n):
+        arg = -(d['IRMAP_MIN_RAW'] + i * d['IRMAP_STEP_US'] - c) / k
+        if exact_exp:
+            v = v_max * scale / (1.0 + math.exp(arg))
+        else:
+            e = exp_avr(F32(arg))
+            v = F32(F32(v_max) * F32(scale)) / F32(F32(1.0) + e) + F32(0.5)
+        table.append(int(v))
+    return table
+
+
+def lookup(table, raw, d):
+    """IrMap_c::lookup()，返回 (值, ( b - a ) * f)"""
+    if raw <= d['IRMAP_MIN_RAW']:
+        return 0.0, 0
+    n = len(table)
+    dd = raw - d['IRMAP_MIN_RAW']
+    i = dd >> d['IRMAP_STEP_SHIFT']
+    if i >= n - 1:
+        return table[-1] / (1 << d['IRMAP_FRAC_BITS']), 0
+    a, b = table[i], table[i + 1]
+    f = dd & (d['IRMAP_STEP_US'] - 1)
+    prod = (b - a) * f
+    v = (a + ((prod + d['IRMAP_STEP_US'] // 2) >> d['IRMAP_STEP_SHIFT'])) & 0xFFFF
+    return v / (1 << d['IRMAP_FRAC_BITS']), prod
+
+
+def reference(c, k, v_max, raw, d):
+    if raw <= d['IRMAP_MIN_RAW']:
+        return 0.0
+    return v_max / (1.0 + math.exp(-(raw - c) / k))
+
+
+def check(c, k, v_max, d, args):
+    """一组参数，返回 (是否通过, 最大误差)"""
+    table = make_table(c, k, v_max, d)
+    ref_table = make_table(c, k, v_max, d, exact_exp=True)
+    n = len(table)
+    diff = sum(1 for a, b in zip(table, ref_table) if a != b)
+    monotone = all(b >= a for a, b in zip(table, table[1:]))
+
+    max_err, at, max_prod = 0.0, 0, 0
+    for raw in range(0, args.raw_max + 1):
+        v, prod = lookup(table, raw, d)
+        max_prod = max(max_prod, prod)
+        e = abs(v - reference(c, k, v_max, raw, d))
+        if e > max_err:
+            max_err, at = e, raw
+
+    raw_max = d['IRMAP_MIN_RAW'] + (n - 1) * d['IRMAP_STEP_US']
+    print(f"{c:>5d}{k:>5d}{v_max:>7d}{n:>6d}{n * 2:>7d}{raw_max:>9d}{max_err:>12.4f}{at:>8d}"
+          f"{'是' if monotone else '否':>7s}{diff:>10d}{max_prod:>12d}")
+
+    ok = True
+    if not monotone:
+        print(f"  ✗ 表不单调：lookup() 里 b - a 会是负的")
+        ok = False
+    if max_prod >= 32768:
+        print(f"  ✗ ( b - a ) * f = {max_prod} 超出 16 位 int")
+        ok = False
+    if max_err > args.max_err:
+        print(f"  ✗ 最大误差 {max_err:.4f} cs 超过 --max-err {args.max_err:g}")
+        ok = False
+    return ok, max_err
+
+
+def main():
+    parser = argparse.ArgumentParser(description='IrMap.h 查找表对照浮点 sigmoid 的误差检查')
+    parser.add_argument('--max-err', type=float, default=0.15, help='允许的最大误差（cs）')
+    parser.add_argument('--raw-max', type=int, default=5000, help='读数扫到多少 us')
+    args = parser.parse_args()
+
+    d = read_defines(os.path.join(ROOT, 'Follower', 'IrMap.h'),
+                     ['IRMAP_MIN_RAW', 'IRMAP_STEP_SHIFT', 'IRMAP_FRAC_BITS', 'IRMAP_TAIL_K'])
+    d['IRMAP_STEP_US'] = 1 << d['IRMAP_STEP_SHIFT']
+
+    params = []
+    for rel in SKETCHES:
+        p = read_params(os.path.join(ROOT, rel))
+        print(f"{rel}: C = {p[0]}, K = {p[1]}, V_MAX = {p[2]}")
+        if p not in params:
+            params.append(p)
+
+    print(f"\n读数 0..{args.raw_max}us 逐个对照，每 {d['IRMAP_STEP_US']}us 一个点，单位 1/{1 << d['IRMAP_FRAC_BITS']} cs")
+    print(f"{'C':>5s}{'K':>5s}{'V_MAX':>7s}{'点数':>5s}{'字节':>5s}{'饱和读数':>7s}{'最大误差(cs)':>10s}"
+          f"{'读数':>6s}{'单调':>5s}{'和f64差':>7s}{'(b-a)*f':>12s}")
+    ok = True
+    for c, k, v_max in params:
+        good, _ = check(c, k, v_max, d, args)
+        ok = ok and good
+
+    print()
+    if not ok:
+        print("✗ 查找表检查没通过，见上面")
+        sys.exit(1)
+    print(f"✓ 表单调，插值不溢出，最大误差都在 {args.max_err:g} cs 以内")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
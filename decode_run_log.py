@@ -0,0 +1,92 @@
+"""
+把 Follower（PureLine_Version/line/Follower）跑完打印的十六进制记录解成 CSV
+
+固件里每条记录是 RunLog.h 的 LogRecord_t（20 字节定点数，小端），打印格式：
+    ========== FOLLOWER LOG (HEX) ==========
+    LOG,版本,每条字节数,记录间隔ms,最老一条的序号,条数
+    <每条一行十六进制>
+    ==========================================
+输出的列和以前直接打印的 CSV 一样，分析脚本不用改：
+    Sample,X_mm,Y_mm,Theta_rad,SpdL_cps,SpdR_cps,IR_center,L_signal,R_signal,Speed_cmd,Steer_cmd
+
+串口监视器带时间戳（"12:34:56.789 -> "）的也可以直接读；跑完以后每 5 秒会重复打印一次，只取第一块。
+
+用法：
+    python decode_run_log.py serial_output.txt line_data.csv
+"""
+
+import csv
+import re
+import struct
+import sys
+
+VERSION = 1
+# x, y, theta, spd_l, spd_r, ir_center, l_signal, r_signal, speed_cmd, steer_cmd
+RECORD = struct.Struct('<10h')
+SCALE = (10.0, 10.0, 1000.0, 10.0, 10.0, 10.0, 1.0, 1.0, 10.0, 100.0)
+
+HEADER = ['Sample', 'X_mm', 'Y_mm', 'Theta_rad', 'SpdL_cps', 'SpdR_cps',
+          'IR_center', 'L_signal', 'R_signal', 'Speed_cmd', 'Steer_cmd']
+# 和原来 printResults() 的小数位一致
+FORMAT = ('{:.2f}', '{:.2f}', '{:.4f}', '{:.1f}', '{:.1f}', '{:.1f}', '{:d}', '{:d}', '{:.1f}', '{:.2f}')
+
+
+def find_log(lines):
+    """返回 (记录间隔 ms, 第一条序号, 每条的字节串列表)"""
+    for i, line in enumerate(lines):
+        if not line.startswith('LOG,'):
+            continue
+        version, size, interval, first, count = (int(v) for v in line[4:].split(','))
+        if version != VERSION or size != RECORD.size:
+            raise ValueError(f"记录格式版本 {version} / {size} 字节，这个脚本只认 {VERSION} / {RECORD.size}")
+        records = []
+        for hex_line in lines[i + 1:]:
+            if hex_line.startswith('====='):
+                break
+            records.append(bytes.fromhex(hex_line))
+        if len(records) != count:
+            print(f"⚠ 头里写 {count} 条，实际读到 {len(records)} 条（串口丢数据？）")
+        return interval, first, records
+    raise ValueError("找不到 LOG, 开头的记录头")
+
+
+def decode(records):
+    rows = []
+    for raw in records:
+        if len(raw) != RECORD.size:
+            print(f"⚠ 跳过长度不对的一行（{len(raw)} 字节）")
+            rows.append(None)
+            continue
+        rows.append([v / s if s != 1.0 else v for v, s in zip(RECORD.unpack(raw), SCALE)])
+    return rows
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("用法: python decode_run_log.py <串口输出.txt> <输出.csv>")
+        sys.exit(1)
+
+    with open(sys.argv[1], 'r', encoding='utf-8', errors='ignore') as f:
+        lines = [re.sub(r'^\s*\d{2}:\d{2}:\d{2}\.\d{3}\s*->\s*', '', l).strip() for l in f]
+    lines = [l for l in lines if l]
+
+    interval, first, records = find_log(lines)
+    rows = decode(records)
+
+    with open(sys.argv[2], 'w', encoding='utf-8', newline='') as f:
+        w = csv.writer(f)
+        w.writerow(HEADER)
+        for k, row in enumerate(rows):
+            if row is None:
+                continue
+            w.writerow([first + k] + [fmt.format(v) for fmt, v in zip(FORMAT, row)])
+
+    n = sum(r is not None for r in rows)
+    print(f"✓ {n} 条记录，间隔 {interval} ms，从第 {first} 条开始 -> {sys.argv[2]}")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
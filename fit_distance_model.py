@@ -0,0 +1,219 @@
+"""
+传感器原始读数 -> 距离 的标定工具
+
+读取 collect_bump_data.py / collect_line_data.py 采集的定距离扫描 CSV
+（distance_cm 加上 bump_L,bump_R,bump_avg 或 line_1,line_2,line_3,center_avg），
+按传感器类型（bump：放电时间 us，line：ADC 计数）各拟合一条单调的距离曲线：
+  - 每个距离取读数中位数，噪声用 MAD 估计（个别跳变的采样不会把曲线拉歪），不低于量化噪声
+  - 读数贴着饱和值（bump 超时 / line 读数为 0）的距离说明已经看不到 leader，不进模型
+  - 中位数对距离做保序回归（PAVA），保证读数 -> 距离单调，然后在读数上分段线性
+  - 置信带：自助法（每个距离内重采样）给曲线本身的 95% 区间，
+    再加单次读数噪声通过局部斜率换算到距离上，合起来是“单次读数”的 95% 半宽
+
+生成 DistanceModel.h，放进草图目录后 Distance.h 会自动使用（同 RobotProfile.h 的用法）。
+
+用法：
+    python fit_distance_model.py bump_data_xxx.csv line_data_xxx.csv --out Follower/DistanceModel.h
+    python fit_distance_model.py bump_data_xxx.csv --bump-column bump_L
+"""
+
+import argparse
+import os
+import sys
+
+import numpy as np
+import pandas as pd
+
+BUMP_TIMEOUT_US = 4500     # 和 BumpTimer.h 一致
+SAT_MARGIN = 0.97          # bump 中位数超过超时的 97% 认为饱和
+LINE_FLOOR = 1.0           # line 中位数低于这个认为看不到
+BOOTSTRAP = 400
+Z95 = 1.96
+
+FAMILIES = {
+    # 名字: (可选列, 默认列, 单位)
+    'bump': (('bump_L', 'bump_R', 'bump_avg'), 'bump_avg', 'us'),
+    'line': (('line_1', 'line_2', 'line_3', 'center_avg'), 'center_avg', 'ADC'),
+}
+
+
+def detect_family(df, path):
+    for name, (cols, _, _) in FAMILIES.items():
+        if any(c in df.columns for c in cols):
+            return name
+    raise ValueError(f"{path}: 认不出是 bump 还是 line 的数据（列: {list(df.columns)}）")
+
+
+def load(paths, columns):
+    """按类型合并所有 CSV，返回 {类型: (距离 mm 数组, 读数数组)}"""
+    data = {}
+    for path in paths:
+        df = pd.read_csv(path)
+        if 'distance_cm' not in df.columns:
+            raise ValueError(f"{path}: 缺少 distance_cm 列")
+        fam = detect_family(df, path)
+        col = columns[fam]
+        if col not in df.columns:
+            raise ValueError(f"{path}: 没有 {col} 列")
+        d = df['distance_cm'].to_numpy(dtype=float) * 10.0
+        r = df[col].to_numpy(dtype=float)
+        print(f"✓ {os.path.basename(path)}: {fam} / {col}, {len(r)} 个采样, {len(np.unique(d))} 个距离")
+        if fam in data:
+            d = np.concatenate((data[fam][0], d))
+            r = np.concatenate((data[fam][1], r))
+        data[fam] = (d, r)
+    return data
+
+
+def saturated(fam, median):
+    if fam == 'bump':
+        return median >= SAT_MARGIN * BUMP_TIMEOUT_US
+    return median < LINE_FLOOR
+
+
+def pava(y, w):
+    """加权保序回归（非降），返回拟合值"""
+    blocks = [[v, wt, 1] for v, wt in zip(y, w)]
+    i = 0
+    while i < len(blocks) - 1:
+        if blocks[i][0] > blocks[i + 1][0]:
+            v0, w0, n0 = blocks[i]
+            v1, w1, n1 = blocks[i + 1]
+            blocks[i] = [(v0 * w0 + v1 * w1) / (w0 + w1), w0 + w1, n0 + n1]
+            del blocks[i + 1]
+            i = max(i - 1, 0)
+        else:
+            i += 1
+    return np.concatenate([[v] * n for v, _, n in blocks])
+
+
+def knots(dist, raw, groups):
+    """每个距离的中位数，保序后合并相同读数，返回 (读数升序, 对应距离)"""
+    med = np.array([np.median(raw[g]) for g in groups])
+    w = np.array([len(g) for g in groups], dtype=float)
+    # 读数随距离变大还是变小
+    sign = 1.0 if np.corrcoef(dist, med)[0, 1] >= 0 else -1.0
+    fit = sign * pava(sign * med, w)
+    # 保序后读数一样的距离取平均，变成严格单调的折线
+    r_k, d_k = [], []
+    for v in np.unique(fit):
+        r_k.append(v)
+        d_k.append(np.mean(dist[fit == v]))
+    return np.array(r_k), np.array(d_k), sign
+
+
+def fit_family(fam, d, r):
+    levels = np.unique(d)
+    groups_all = [np.where(d == lv)[0] for lv in levels]
+    med = np.array([np.median(r[g]) for g in groups_all])
+    sigma = np.array([1.4826 * np.median(np.abs(r[g] - np.median(r[g]))) for g in groups_all])
+    # 读数是整数（bump 还是 4us 一步），MAD 可能是 0：至少按量化噪声算
+    steps = np.diff(np.unique(r))
+    q = steps.min() if len(steps) else 1.0
+    sigma = np.maximum(sigma, q / np.sqrt(12.0))
+    keep = ~saturated(fam, med)
+    if keep.sum() < 2:
+        raise ValueError(f"{fam}: 不饱和的距离少于两个，没法拟合")
+
+    levels = levels[keep]
+    groups = [groups_all[i] for i in np.where(keep)[0]]
+    sigma = sigma[keep]
+    r_k, d_k, sign = knots(levels, r, groups)
+
+    # 自助法：每个距离内有放回重采样，看折线在各节点读数处给出的距离怎么变
+    rng = np.random.default_rng(0)
+    boot = np.empty((BOOTSTRAP, len(r_k)))
+    for b in range(BOOTSTRAP):
+        rs = [rng.choice(r[g], size=len(g)) for g in groups]
+        rb = np.concatenate(rs)
+        idx = np.cumsum([0] + [len(g) for g in groups])
+        gb = [np.arange(idx[i], idx[i + 1]) for i in range(len(groups))]
+        kb_r, kb_d, _ = knots(levels, rb, gb)
+        boot[b] = np.interp(r_k, kb_r, kb_d)
+    lo, hi = np.percentile(boot, [2.5, 97.5], axis=0)
+    curve_half = (hi - lo) / 2.0
+
+    # 单次读数噪声 -> 距离：除以节点两侧折线斜率的平均
+    slope = np.gradient(d_k, r_k) if len(r_k) > 1 else np.array([0.0])
+    sig_k = np.interp(d_k, levels, sigma)
+    noise_half = Z95 * sig_k * np.abs(slope)
+    band = np.sqrt(curve_half ** 2 + noise_half ** 2)
+
+    return {
+        'fam': fam, 'raw': r_k, 'mm': d_k, 'band': band, 'curve': curve_half, 'noise': noise_half,
+        'sign': sign, 'levels': levels, 'n': len(d), 'dropped': int((~keep).sum()),
+        'residual': np.array([np.interp(np.median(r[g]), r_k, d_k) - lv for g, lv in zip(groups, levels)]),
+    }
+
+
+def report(m):
+    unit = FAMILIES[m['fam']][2]
+    print("\n" + "=" * 60)
+    print(f"{m['fam']}：{m['n']} 个采样，{len(m['levels'])} 个距离进模型，{m['dropped']} 个距离饱和去掉")
+    print(f"读数随距离{'增大' if m['sign'] > 0 else '减小'}，{len(m['raw'])} 个节点")
+    print(f"{'读数(' + unit + ')':>12s}{'距离(mm)':>10s}{'±95%(mm)':>10s}{'曲线':>8s}{'噪声':>8s}")
+    for r, d, b, c, n in zip(m['raw'], m['mm'], m['band'], m['curve'], m['noise']):
+        print(f"{r:12.1f}{d:10.1f}{b:10.1f}{c:8.1f}{n:8.1f}")
+    print(f"各距离中位数回代的误差: 最大 {np.max(np.abs(m['residual'])):.1f} mm")
+    print("=" * 60)
+
+
+def rounded_knots(m):
+    """读数取整成 uint16 以后，相邻节点可能变成同一个读数：合并成一个（距离取平均，band 取大的）
+    保证写进表的读数严格升序，Distance.h 插值时不会除以 0"""
+    raw = np.round(m['raw']).astype(int)
+    r_out, d_out, b_out = [], [], []
+    for v in np.unique(raw):
+        sel = raw == v
+        r_out.append(int(v))
+        d_out.append(int(round(np.mean(m['mm'][sel]))))
+        b_out.append(min(255, int(np.ceil(np.max(m['band'][sel])))))
+    if len(r_out) < 2:
+        raise ValueError(f"{m['fam']}: 取整以后只剩 {len(r_out)} 个节点，没法插值")
+    if len(r_out) < len(raw):
+        print(f"⚠ {m['fam']}: 读数取整后有 {len(raw) - len(r_out)} 个节点重合，已合并")
+    return r_out, d_out, b_out
+
+
+def write_header(path, models, sources):
+    guard = '_DISTANCEMODEL_H'
+    with open(path, 'w', encoding='utf-8', newline='\n') as f:
+        f.write(f"#ifndef {guard}\n#define {guard}\n\n")
+        f.write(f"// 由 fit_distance_model.py 生成，请勿手改（{', '.join(sources)}）\n")
+        f.write("// 读数升序的分段线性表，距离 mm，band 是单次读数的 95% 半宽（mm）\n")
+        f.write("// 超出表的读数范围 Distance.h 返回 DIST_OUT_OF_RANGE\n")
+        for m in models:
+            p = f"dist_{m['fam']}"
+            P = p.upper()
+            unit = FAMILIES[m['fam']][2]
+            f.write(f"\n// {m['fam']}：读数单位 {unit}，读数越大距离越{'远' if m['sign'] > 0 else '近'}\n")
+            raw, mm, band = rounded_knots(m)
+            f.write(f"#define {P}_N {len(raw)}\n")
+            f.write(f"const uint16_t {p}_raw[ {P}_N ] PROGMEM = {{ " + ", ".join(map(str, raw)) + " };\n")
+            f.write(f"const uint16_t {p}_mm[ {P}_N ] PROGMEM = {{ " + ", ".join(map(str, mm)) + " };\n")
+            f.write(f"const uint8_t {p}_band[ {P}_N ] PROGMEM = {{ " + ", ".join(map(str, band)) + " };\n")
+        f.write("\n#endif\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='定距离扫描数据拟合 读数 -> 距离 模型')
+    parser.add_argument('csv', nargs='+', help='collect_bump_data.py / collect_line_data.py 的 CSV')
+    parser.add_argument('--bump-column', default=FAMILIES['bump'][1], help='bump 用哪一列')
+    parser.add_argument('--line-column', default=FAMILIES['line'][1], help='line 用哪一列')
+    parser.add_argument('--out', default='DistanceModel.h', help='输出头文件路径')
+    args = parser.parse_args()
+
+    data = load(args.csv, {'bump': args.bump_column, 'line': args.line_column})
+    models = [fit_family(fam, d, r) for fam, (d, r) in sorted(data.items())]
+    for m in models:
+        report(m)
+
+    write_header(args.out, models, [os.path.basename(p) for p in args.csv])
+    print(f"\n✓ 已写入 {args.out}")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
@@ -0,0 +1,357 @@
+"""
+里程计回放：定点版 Kinematics_c 和 float 版的位姿差（改 Kinematics.h 以后在电脑上跑一遍）
+
+按 Follower/Kinematics.h 的算法逐拍重算：
+  - float 版：AVR 上 double 就是 float，全部用 float32 算，和车上一致
+  - 定点版：Q16.16 位置、2^24/圈的角度、kin_sin_table 查表插值，
+    按 32 位 long 回绕、算术右移、整数除法向零取整，逐位和车上一样；sin 表直接从头文件里解析
+两者每拍的位置差取最大值和终点值，另外给出 float64 的真值作参考。
+
+--rates：比较三种积分方式（KIN_EULER / KIN_MIDPOINT / KIN_ARC）在不同更新周期下的漂移。
+每条记录先按 --tick-ms 分成细拍，再把相邻几拍的计数合起来当一次 update()（更新周期拉长），
+终点和 float64 精确圆弧逐细拍积分的结果比。另外跑一条恒定曲率的合成轨迹（一直转圈）。
+
+输入（可以混着给，目录会递归查找 *.csv）：
+  - 带累计计数 e0,e1 或 Count_e0,Count_e1 列的 CSV（和 calibrate_odometry.py 同一种格式），每行一拍
+  - 跑车记录（X_mm,Y_mm,Theta_rad，Final/数据 下的那种）：每条记录间隔 --log-ms，
+    从相邻两条的位姿反推左右轮计数，再按 --tick-ms 均匀分到每一拍（取整，余数带到下一拍）
+
+CPU 周期数要在车上量：Follower.ino 打开 KINEMATICS_BENCHMARK，
+KINEMATICS_FIXED_POINT 取 0 / 1 各烧一次，串口输出每次 update() 的 us 和周期数。
+
+用法：
+    python replay_odometry.py
+    python replay_odometry.py Final/数据/30° --log-ms 400 --tick-ms 25
+    python replay_odometry.py --rates --tick-ms 10 --factors 1,2,5,10,25
+"""
+
+import argparse
+import glob
+import math
+import os
+import re
+import sys
+
+import numpy as np
+import pandas as pd
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+HEADER = os.path.join(ROOT, 'Follower', 'Kinematics.h')
+
+COUNT_PER_REV = 358.3
+WHEEL_RADIUS = 16.63        # 和 Kinematics.h 的默认值一致（没有 RobotProfile.h 时）
+WHEEL_SEP = 43.15
+
+KIN_ANGLE_ONE_REV = 1 << 24
+F = np.float32
+
+
+def i32(v):
+    """按 32 位 long 回绕"""
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def cdiv(a, b):
+    """C 的整数除法（向零取整）"""
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b >= 0) else -q
+
+
+def load_sin_table(path):
+    with open(path, 'r', encoding='utf-8', errors='ignore') as f:
+        text = f.read()
+    m = re.search(r'kin_sin_table\s*\[\s*257\s*\]\s*PROGMEM\s*=\s*\{([^}]*)\}', text)
+    if not m:
+        raise ValueError(f"{path}: 找不到 kin_sin_table")
+    table = [int(v) for v in m.group(1).split(',') if v.strip()]
+    if len(table) != 257:
+        raise ValueError(f"{path}: kin_sin_table 有 {len(table)} 项，应为 257")
+    return table
+
+
+class Constants:
+    """Kinematics.h 里的 const float / const long，按 float32 算"""
+
+    def __init__(self, r_l=WHEEL_RADIUS, r_r=WHEEL_RADIUS, sep=WHEEL_SEP):
+        pi = F(math.pi)
+        cpr = F(COUNT_PER_REV)
+        self.r_l, self.r_r, self.sep = F(r_l), F(r_r), F(sep)
+        self.mpc_l = F(F(2.0) * self.r_l * pi) / cpr
+        self.mpc_r = F(F(2.0) * self.r_r * pi) / cpr
+        self.mq_l = int(F(self.mpc_l * F(65536.0) + F(0.5)))
+        self.mq_r = int(F(self.mpc_r * F(65536.0) + F(0.5)))
+        k = F(KIN_ANGLE_ONE_REV) / F(F(2.0) * pi)
+        self.tq_l = int(F(self.mpc_l / F(self.sep * F(2.0)) * k + F(0.5)))
+        self.tq_r = int(F(self.mpc_r / F(self.sep * F(2.0)) * k + F(0.5)))
+
+
+class FloatKin:
+    """float 版 update()（KIN_EULER / KIN_MIDPOINT / KIN_ARC）"""
+
+    def __init__(self, c, mode):
+        self.c, self.mode = c, mode
+        self.x = self.y = self.theta = F(0.0)
+
+    def update(self, d0, d1):
+        c = self.c
+        mean = F(F(F(d1) * c.mpc_l) + F(F(d0) * c.mpc_r)) / F(2.0)
+        th = F(F(F(d0) * c.mpc_r) - F(F(d1) * c.mpc_l)) / F(c.sep * F(2.0))
+        heading = self.theta if self.mode == 'euler' else F(self.theta + th * F(0.5))
+        if self.mode == 'arc':
+            h2 = F(th * th * F(0.25))
+            mean = F(mean * F(F(1.0) - h2 * F(1.0 / 6.0) + h2 * h2 * F(1.0 / 120.0)))
+        self.x = F(self.x + mean * np.cos(heading, dtype=F))
+        self.y = F(self.y + mean * np.sin(heading, dtype=F))
+        self.theta = F(self.theta + th)
+
+    def pose(self):
+        return float(self.x), float(self.y), float(self.theta)
+
+
+class FixedKin:
+    """定点版 update()，逐位模拟 32 位整数运算"""
+
+    def __init__(self, c, mode, sin_table):
+        self.c, self.mode, self.tab = c, mode, sin_table
+        self.x_q16 = self.y_q16 = self.th_q24 = 0
+
+    def sin(self, a):
+        idx = (a >> 16) & 0xFF
+        frac = (a >> 8) & 0xFF
+        s0, s1 = self.tab[idx], self.tab[idx + 1]
+        return s0 + (i32((s1 - s0) * frac) >> 8)
+
+    def cos(self, a):
+        return self.sin(i32(a + KIN_ANGLE_ONE_REV // 4))
+
+    def update(self, d0, d1):
+        c = self.c
+        dist_q16 = i32(d0 * c.mq_r + d1 * c.mq_l) >> 1
+        dth_q24 = i32(d0 * c.tq_r - d1 * c.tq_l)
+        dist_q8 = (dist_q16 + 128) >> 8
+        head = self.th_q24 if self.mode == 'euler' else i32(self.th_q24 + (dth_q24 >> 1))
+        if self.mode == 'arc':
+            h_q16 = i32(dth_q24 * 804) >> 16
+            h2_q16 = i32(h_q16 * h_q16) >> 16
+            k_q16 = 65536 - cdiv(h2_q16, 6) + cdiv(i32(h2_q16 * h2_q16) >> 16, 120)
+            dist_q8 = i32(dist_q8 * k_q16) >> 16
+        self.x_q16 = i32(self.x_q16 + (i32(dist_q8 * self.cos(head) + 64) >> 7))
+        self.y_q16 = i32(self.y_q16 + (i32(dist_q8 * self.sin(head) + 64) >> 7))
+        self.th_q24 = i32(self.th_q24 + dth_q24)
+
+    def pose(self):
+        return (self.x_q16 / 65536.0, self.y_q16 / 65536.0,
+                self.th_q24 * 2.0 * math.pi / KIN_ANGLE_ONE_REV)
+
+
+class ExactKin:
+    """float64 精确圆弧，当真值"""
+
+    def __init__(self, c):
+        self.c = c
+        self.x = self.y = self.theta = 0.0
+
+    def update(self, d0, d1):
+        c = self.c
+        mean = (d1 * float(c.mpc_l) + d0 * float(c.mpc_r)) / 2.0
+        th = (d0 * float(c.mpc_r) - d1 * float(c.mpc_l)) / (2.0 * float(c.sep))
+        h = th / 2.0
+        chord = math.sin(h) / h if abs(h) > 1e-12 else 1.0
+        self.x += mean * chord * math.cos(self.theta + h)
+        self.y += mean * chord * math.sin(self.theta + h)
+        self.theta += th
+
+    def pose(self):
+        return self.x, self.y, self.theta
+
+
+def counts_from_pose(df, c, log_ms, tick_ms, exact=False):
+    """跑车记录 -> 每拍 (d0, d1) 计数增量；exact 时返回没取整的增量（轮子真实转过的量）"""
+    x = df['X_mm'].to_numpy(dtype=float)
+    y = df['Y_mm'].to_numpy(dtype=float)
+    th = df['Theta_rad'].to_numpy(dtype=float)
+    sub = max(1, int(round(log_ms / tick_ms)))
+    mpc = float(c.mpc_l + c.mpc_r) / 2.0
+    d0s, d1s = [], []
+    acc0 = acc1 = 0.0
+    for k in range(1, len(x)):
+        dth = th[k] - th[k - 1]
+        heading = th[k - 1] + dth / 2.0
+        dist = (x[k] - x[k - 1]) * math.cos(heading) + (y[k] - y[k - 1]) * math.sin(heading)
+        # dist = (d0 + d1) / 2 * mpc，dth = (d0 - d1) * mpc / (2 * sep)
+        n0 = (dist + dth * float(c.sep)) / mpc
+        n1 = (dist - dth * float(c.sep)) / mpc
+        for _ in range(sub):
+            acc0 += n0 / sub
+            acc1 += n1 / sub
+            if exact:
+                d0s.append(n0 / sub)
+                d1s.append(n1 / sub)
+                continue
+            i0, i1 = int(round(acc0)), int(round(acc1))
+            acc0 -= i0
+            acc1 -= i1
+            d0s.append(i0)
+            d1s.append(i1)
+    if exact:
+        return np.array(d0s), np.array(d1s)
+    return np.array(d0s, dtype=np.int64), np.array(d1s, dtype=np.int64)
+
+
+def load_run(path, c, log_ms, tick_ms, exact=False):
+    """返回每拍 (d0, d1)，认不出格式返回 None；exact 见 counts_from_pose()"""
+    try:
+        df = pd.read_csv(path)
+    except pd.errors.EmptyDataError:
+        return None
+    for c0, c1 in (('e0', 'e1'), ('Count_e0', 'Count_e1')):
+        if c0 in df.columns and c1 in df.columns:
+            e0 = df[c0].to_numpy(dtype=np.int64)
+            e1 = df[c1].to_numpy(dtype=np.int64)
+            return np.diff(e0), np.diff(e1)
+    if all(col in df.columns for col in ('X_mm', 'Y_mm', 'Theta_rad')) and len(df) > 1:
+        return counts_from_pose(df, c, log_ms, tick_ms, exact)
+    return None
+
+
+def find_runs(paths):
+    files = []
+    for p in paths:
+        if os.path.isdir(p):
+            files += sorted(glob.glob(os.path.join(p, '**', '*.csv'), recursive=True))
+        else:
+            files.append(p)
+    return files
+
+
+def compare(d0, d1, kins):
+    """同一串增量喂给几个实现，返回每个实现相对第一个的 (最大位置差, 终点位置差, 终点航向差)"""
+    ref = kins[0]
+    out = [[0.0, 0.0, 0.0] for _ in kins[1:]]
+    for a, b in zip(d0.tolist(), d1.tolist()):
+        for k in kins:
+            k.update(a, b)
+        rx, ry, _ = ref.pose()
+        for o, k in zip(out, kins[1:]):
+            x, y, _ = k.pose()
+            o[0] = max(o[0], math.hypot(x - rx, y - ry))
+    rx, ry, rt = ref.pose()
+    for o, k in zip(out, kins[1:]):
+        x, y, t = k.pose()
+        o[1] = math.hypot(x - rx, y - ry)
+        o[2] = abs(t - rt)
+    return out
+
+
+def group(d, factor):
+    """相邻 factor 拍的计数合成一次更新"""
+    n = len(d) // factor * factor
+    return d[:n].reshape(-1, factor).sum(axis=1)
+
+
+def final_error(d0, d1, kin, ref):
+    for a, b in zip(d0.tolist(), d1.tolist()):
+        kin.update(a, b)
+    x, y, _ = kin.pose()
+    rx, ry, _ = ref
+    return math.hypot(x - rx, y - ry)
+
+
+def rate_table(runs, c, tab, tick_ms, factors):
+    """每种积分方式、每个更新周期，所有记录里终点误差的最大值
+    runs 里每条是 (d0, d1, r0, r1)：d 是编码器整数计数，r 是轮子真实转过的量（计数，可以是小数）"""
+    modes = ('euler', 'midpoint', 'arc')
+    worst = {(m, impl, f): 0.0 for m in modes for impl in ('float', 'fixed') for f in factors}
+    span = math.lcm(*factors)
+    for d0, d1, r0, r1 in runs:
+        # 真值：真实轮转量逐细拍做精确圆弧（截到所有周期的公倍数，各周期用同一段）
+        n = len(d0) // span * span
+        d0, d1 = d0[:n], d1[:n]
+        ref = ExactKin(c)
+        for a, b in zip(r0[:n].tolist(), r1[:n].tolist()):
+            ref.update(a, b)
+        ref = ref.pose()
+        for f in factors:
+            g0, g1 = group(d0, f), group(d1, f)
+            for m in modes:
+                for impl, kin in (('float', FloatKin(c, m)), ('fixed', FixedKin(c, m, tab))):
+                    key = (m, impl, f)
+                    worst[key] = max(worst[key], final_error(g0, g1, kin, ref))
+
+    print(f"\n终点误差（mm，相对真实轮转量逐 {tick_ms:g}ms 做精确圆弧；每格取所有记录的最大值）")
+    print(f"{'积分':>10s}{'实现':>7s}" + "".join(f"{f * tick_ms:>9g}ms" for f in factors))
+    for m in modes:
+        for impl in ('float', 'fixed'):
+            print(f"{m:>10s}{impl:>7s}" + "".join(f"{worst[(m, impl, f)]:11.2f}" for f in factors))
+    return worst
+
+
+def constant_curvature(ticks, d0, d1):
+    """一直以同样的左右轮计数转圈的合成轨迹"""
+    a, b = np.full(ticks, d0, dtype=np.int64), np.full(ticks, d1, dtype=np.int64)
+    return a, b, a, b
+
+
+def main():
+    parser = argparse.ArgumentParser(description='定点 / float 里程计回放对比')
+    parser.add_argument('data', nargs='*', default=[os.path.join(ROOT, 'Final', '数据')],
+                        help='CSV 文件或目录')
+    parser.add_argument('--log-ms', type=float, default=400.0, help='跑车记录相邻两条的间隔 (ms)')
+    parser.add_argument('--tick-ms', type=float, default=25.0, help='Kinematics 更新周期 (ms)')
+    parser.add_argument('--mode', default='arc', choices=('euler', 'midpoint', 'arc'),
+                        help='KINEMATICS_INTEGRATION')
+    parser.add_argument('--rates', action='store_true', help='比较三种积分方式在不同更新周期下的漂移')
+    parser.add_argument('--factors', default='1,2,5,10,25', help='--rates：更新周期是细拍的几倍')
+    args = parser.parse_args()
+
+    c = Constants()
+    tab = load_sin_table(HEADER)
+    print(f"mm/count L/R: {float(c.mpc_l):.5f}/{float(c.mpc_r):.5f}, Q16: {c.mq_l}/{c.mq_r}, "
+          f"dθ/count Q24: {c.tq_l}/{c.tq_r}, 积分: {args.mode}")
+
+    if args.rates:
+        factors = [int(v) for v in args.factors.split(',')]
+        runs = []
+        for path in find_runs(args.data):
+            run = load_run(path, c, args.log_ms, args.tick_ms)
+            if run is not None and len(run[0]) >= math.lcm(*factors):
+                # 跑车记录没有原始计数：真实轮转量用反推出来、还没取整的值；计数 CSV 就是计数本身
+                exact = load_run(path, c, args.log_ms, args.tick_ms, exact=True)
+                runs.append(run + exact)
+        print(f"{len(runs)} 条记录，细拍 {args.tick_ms:g}ms")
+        rate_table(runs, c, tab, args.tick_ms, factors)
+
+        # 右轮每拍 7 个计数、左轮 5 个：5000 拍大约转 34rad（5 圈多）
+        print("\n恒定曲率合成轨迹：右 7 / 左 5 计数每拍，5000 拍")
+        rate_table([constant_curvature(5000, 7, 5)], c, tab, args.tick_ms, factors)
+        print("\n✓ 回放完成")
+        return
+
+    rows = []
+    for path in find_runs(args.data):
+        run = load_run(path, c, args.log_ms, args.tick_ms)
+        if run is None or len(run[0]) == 0:
+            continue
+        d0, d1 = run
+        (fx, ex) = compare(d0, d1, [FloatKin(c, args.mode), FixedKin(c, args.mode, tab), ExactKin(c)])
+        rows.append((os.path.relpath(path, ROOT), len(d0), fx, ex))
+
+    if not rows:
+        print("⚠ 没有找到能用的 CSV")
+        sys.exit(1)
+
+    print(f"\n{'记录':40s}{'拍数':>6s}{'定点-float 最大':>16s}{'终点':>8s}{'航向(mrad)':>12s}{'float-真值 终点':>16s}")
+    for name, n, fx, ex in rows:
+        print(f"{name[-40:]:40s}{n:6d}{fx[0]:14.3f}mm{fx[1]:6.3f}mm{fx[2] * 1000:12.3f}{ex[1]:14.3f}mm")
+
+    worst = max(r[2][0] for r in rows)
+    print(f"\n{len(rows)} 条记录，{sum(r[1] for r in rows)} 拍，定点相对 float 的位置差最大 {worst:.3f} mm")
+    print("✓ 回放完成（周期数见 KINEMATICS_BENCHMARK）")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
@@ -0,0 +1,144 @@
+"""
+bump / line 频分复用的信号级仿真（上车前先在电脑上验证）
+
+按固件的做法逐拍模拟：
+  - leader：Carrier.h 的 beginFdm()，64us 一拍，偶数拍 bump、奇数拍 line，
+    各自的方波（bump 约 651Hz，line 约 434Hz）只在自己的拍里开
+  - 传感器：一阶低通（--tau-us），读数 = 环境光 - 收到的发射管光，
+    环境光带 100/120Hz 灯光闪烁和二、三次谐波，再加 ADC 噪声
+  - follower：后台 ADC 依次转换 5 路 line + 左 bump，每路 13 个 ADC 时钟加中断里重启的 1~2 个时钟，
+    每轮开头按 micros() 取参考相位，±31 的正弦表，--window 轮一个窗口（默认 64，同 Follower.ino 的 FDM 设置），
+    减掉均值的贡献（同 LineSensors.h）
+
+对三种情况（两组都开 / 只开 bump / 只开 line）输出 line 中间一路在 line 载波、
+左 bump 在 bump 载波上解出的幅度；另一组关掉时读到的就是串扰加噪声底。
+
+用法：
+    python simulate_fdm.py --tau-us 100 --flicker 60 --mains 50
+"""
+
+import argparse
+import math
+import sys
+
+import numpy as np
+
+TICK_US = 64
+L_HALF_TICKS = 18          # 1152us，和 Carrier.h / LineSensors.h 一致
+B_HALF_TICKS = 12          # 768us
+ADC_CLK_US = 8
+REF_AMP = 31
+SIN_TABLE = np.round(REF_AMP * np.sin(2 * np.pi * np.arange(32) / 32)).astype(np.int64)
+
+# 每路收到的 (bump 光, line 光)，ADC 计数：5 路 line + 左 bump
+GAINS = [(20, 60), (20, 80), (30, 100), (20, 80), (20, 60), (120, 15)]
+LINE_CH = 2
+BUMP_CH = 5
+
+
+def leader_ticks(n_ticks, bump_on, line_on):
+    """每一拍 bump / line 发射管是否点亮"""
+    k = np.arange(n_ticks)
+    bump_tick = (k % 2 == 0)
+    sq_b = (k // B_HALF_TICKS) % 2 == 0
+    sq_l = (k // L_HALF_TICKS) % 2 == 0
+    return bump_tick & sq_b & bump_on, ~bump_tick & sq_l & line_on
+
+
+def make_sensor(lb, ll, gain_b, gain_l, tau_s, mains, flicker):
+    """返回 t -> 读数；发射管光只在拍边界变化，拍内按指数精确计算"""
+    light = gain_b * lb + gain_l * ll
+    decay = math.exp(-TICK_US * 1e-6 / tau_s)
+    y_start = np.empty(len(light))
+    y = 0.0
+    for i, target in enumerate(light):
+        y_start[i] = y
+        y = target + (y - target) * decay
+    f = 2.0 * mains
+
+    def read(t):
+        i = min(int(t / (TICK_US * 1e-6)), len(light) - 1)
+        dt = t - i * TICK_US * 1e-6
+        target = light[i]
+        received = target + (y_start[i] - target) * math.exp(-dt / tau_s)
+        ambient = 400.0 + flicker * (math.sin(2 * math.pi * f * t)
+                                     + 0.3 * math.sin(2 * math.pi * 2 * f * t + 1.0)
+                                     + 0.15 * math.sin(2 * math.pi * 3 * f * t + 2.0))
+        return ambient - received
+    return read
+
+
+def demodulate(sensors, seconds, window, rng):
+    """后台 ADC + 两路锁相，返回每个窗口的 (line 幅度[], bump 幅度[])"""
+    steps = [2 ** 32 // (2 * L_HALF_TICKS * TICK_US), 2 ** 32 // (2 * B_HALF_TICKS * TICK_US)]
+    n_ch = len(sensors)
+    acc_i = np.zeros((2, n_ch))
+    acc_q = np.zeros((2, n_ch))
+    acc_v = np.zeros(n_ch)
+    acc_c = np.zeros(2)
+    acc_s = np.zeros(2)
+    sweeps = 0
+    out = []
+    t = 0.0
+    while t < seconds:
+        # 第一路的中断里取相位
+        t_isr = t + 14 * ADC_CLK_US * 1e-6
+        c = np.zeros(2)
+        s = np.zeros(2)
+        for r in range(2):
+            idx = ((int(t_isr * 1e6) * steps[r]) & 0xFFFFFFFF) >> 27
+            s[r] = SIN_TABLE[idx]
+            c[r] = SIN_TABLE[(idx + 8) & 31]
+        acc_c += c
+        acc_s += s
+        for ch in range(n_ch):
+            v = sensors[ch](t + 1.5 * ADC_CLK_US * 1e-6) + rng.normal(0.0, 2.0)
+            v = int(min(1023, max(0, round(v))))
+            acc_i[:, ch] += v * c
+            acc_q[:, ch] += v * s
+            acc_v[ch] += v
+            t += (13 + rng.integers(1, 3)) * ADC_CLK_US * 1e-6
+        sweeps += 1
+        if sweeps == window:
+            i_ = acc_i - np.outer(acc_c, acc_v) / window
+            q_ = acc_q - np.outer(acc_s, acc_v) / window
+            out.append(np.hypot(i_, q_) * math.pi / (REF_AMP * window))
+            acc_i[:] = 0
+            acc_q[:] = 0
+            acc_v[:] = 0
+            acc_c[:] = 0
+            acc_s[:] = 0
+            sweeps = 0
+    return np.array(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='bump/line 频分复用信号级仿真')
+    parser.add_argument('--tau-us', type=float, default=100.0, help='传感器一阶时间常数 (us)')
+    parser.add_argument('--flicker', type=float, default=60.0, help='灯光闪烁基波幅度 (ADC 计数)')
+    parser.add_argument('--mains', type=int, default=50, choices=(50, 60), help='市电频率 (Hz)')
+    parser.add_argument('--seconds', type=float, default=1.5, help='每种情况仿真时长 (s)')
+    parser.add_argument('--window', type=int, default=64, help='解调窗口轮数 (2^LINE_LOCKIN_SHIFT)')
+    args = parser.parse_args()
+
+    n_ticks = int(args.seconds * 1e6 / TICK_US) + 1
+    print(f"line 载波 {1e6 / (2 * L_HALF_TICKS * TICK_US):.1f}Hz, bump 载波 {1e6 / (2 * B_HALF_TICKS * TICK_US):.1f}Hz, "
+          f"tau {args.tau_us:.0f}us, 闪烁 {args.flicker:.0f} @ {2 * args.mains}Hz, 窗口 {args.window} 轮")
+    print(f"期望幅度（一半的拍 * 一阶低通衰减前）: line {GAINS[LINE_CH][1] / 2:.1f}, bump {GAINS[BUMP_CH][0] / 2:.1f}")
+    print(f"{'':12s}{'line@line':>16s}{'bump@bump':>16s}")
+
+    for name, bump_on, line_on in (('两组都开', True, True), ('只开 bump', True, False), ('只开 line', False, True)):
+        rng = np.random.default_rng(1)
+        lb, ll = leader_ticks(n_ticks, bump_on, line_on)
+        sensors = [make_sensor(lb, ll, gb, gl, args.tau_us * 1e-6, args.mains, args.flicker) for gb, gl in GAINS]
+        res = demodulate(sensors, args.seconds, args.window, rng)[2:]
+        line = res[:, 0, LINE_CH]
+        bump = res[:, 1, BUMP_CH]
+        print(f"{name:12s}{line.mean():9.1f} ±{line.std():4.1f}{bump.mean():9.1f} ±{bump.std():4.1f}")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
@@ -0,0 +1,428 @@
+"""
+轮速环 PID 的电脑仿真（改 DualPID.h / Fix16.h 以后跑一遍）
+
+按固件的算法逐拍计算：
+  - Fix16 版：DualPID_c<Fix16, PID_CLAMP>，Q16.16 逐位模拟 Fix16.h 的乘法（4 个 16x16 乘积，
+    低位截断）、numFromMicros() 的 us * 4295 >> 16、构造时的四舍五入
+  - float 版：原来 PID_c::update()，float32，dt 用 millis() 差（整数毫秒）
+电机按一阶惯性 + PWM 死区模拟，1ms 一步积分，记下每个编码器边沿的时刻；
+测速按 WheelSpeed_c（低速周期法、高速计数法），PWM 按 taskPID 限幅在 0..PWM_MAX。
+
+两种比较：
+  1. 回放：float 版闭环跑一遍，把每拍的 (demand, measurement, dt) 原样喂给 Fix16 版，
+     看同一串输入下两者输出差多少（纯算术误差）
+  2. 闭环：两种实现各自带一个电机跑同一串速度指令，比较调节时间和超调
+     --jitter-us 给调度周期加抖动（Fix16 版用实测 us，float 版只看得到整数毫秒）
+
+--relay：按 autoTuneWheels() 的流程做继电自整定（先开环在 死区 + 8 PWM 下稳定，
+平均速度当 setpoint，再 ±6 PWM、滞环 15 cps 继电，每 40ms 一拍），
+算出 Ku / Tu 和 PI 参数，然后手调参数和整定参数各跑一遍同样的速度指令（Fix16 DualPID_c）。
+
+用法：
+    python simulate_pid.py
+    python simulate_pid.py --jitter-us 800 --kp 0.07 --ki 0.00005
+    python simulate_pid.py --relay --rule tl --motor-tau-ms 80
+"""
+
+import argparse
+import math
+import sys
+
+import numpy as np
+
+F = np.float32
+
+PID_PERIOD_MS = 40
+COUNT_RES = 1.0            # 编码器 1 个计数
+
+# 电机：一阶惯性，死区以上每 PWM 多少 counts/s
+MOTOR_GAIN_CPS = 12.0
+MOTOR_DEADZONE_PWM = 10.0
+MOTOR_TAU_MS = 60.0
+KF_PWM = 13.5              # Follower.ino 的 kF_L，前馈直接加在 PID 输出上
+PWM_MAX = 60.0
+
+# WheelSpeed.h
+SPEED_PERIOD_EDGES = 4
+SPEED_MIX_LO = 3
+SPEED_MIX_HI = 8
+SPEED_STOP_US = 150000
+
+
+# ---------- Fix16（Q16.16），和 Fix16.h 逐位一致 ----------
+
+def i32(v):
+    v &= 0xFFFFFFFF
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+def fx(f):
+    """Fix16( float )：float32 里乘 65536 再加 ±0.5，向零取整"""
+    s = F(F(f) * F(65536.0))
+    s = F(s + (F(0.5) if F(f) >= 0 else F(-0.5)))
+    return i32(int(s))
+
+
+def fx_mul(a, b):
+    neg = (a < 0) != (b < 0)
+    a, b = abs(a) & 0xFFFFFFFF, abs(b) & 0xFFFFFFFF
+    ah, al = a >> 16, a & 0xFFFF
+    bh, bl = b >> 16, b & 0xFFFF
+    r = ((ah * bh) << 16) + ah * bl + al * bh + ((al * bl) >> 16)
+    r &= 0xFFFFFFFF
+    return i32(-r) if neg else i32(r)
+
+
+def fx_from_micros(us):
+    us = min(us, 999000)
+    return ((us * 4295) & 0xFFFFFFFF) >> 16
+
+
+def fx_to_float(r):
+    return r / 65536.0
+
+
+class FixPID:
+    """DualPID_c<Fix16, PID_CLAMP> 的一个通道"""
+
+    def __init__(self, kp, ki, kd):
+        self.kp, self.ki = fx(kp), fx(ki * 1000.0)
+        self.lo, self.hi = fx(-255.0), fx(255.0)
+        self.last = self.fb = 0
+
+    def update(self, demand, meas, dt_us):
+        if dt_us == 0:
+            return fx_to_float(self.fb)
+        dt_s = fx_from_micros(dt_us)
+        err = i32(fx(demand) - fx(meas))
+        delta = i32(fx_mul(self.kp, i32(err - self.last)) + fx_mul(fx_mul(self.ki, dt_s), err))
+        fb = i32(self.fb + delta)
+        fb = min(max(fb, self.lo), self.hi)
+        self.fb, self.last = fb, err
+        return fx_to_float(fb)
+
+
+class FloatPID:
+    """PID_c::update()（只用到 P / I 和限幅），dt 为整数毫秒"""
+
+    def __init__(self, kp, ki, kd):
+        self.kp, self.ki, self.kd = F(kp), F(ki), F(kd)
+        self.last = self.prev = self.fb = F(0.0)
+
+    def update(self, demand, meas, dt_ms):
+        if dt_ms == 0:
+            return float(self.fb)
+        dt = F(dt_ms)
+        err = F(F(demand) - F(meas))
+        p = F(self.kp * F(err - self.last))
+        i = F(F(self.ki * err) * dt)
+        d = F(F(self.kd * F(F(err - F(2.0) * self.last) + self.prev)) / dt)
+        fb = F(self.fb + F(F(p + i) + d))
+        fb = min(max(fb, F(-255.0)), F(255.0))
+        self.fb, self.prev, self.last = F(fb), self.last, err
+        return float(self.fb)
+
+
+class Motor:
+    """一阶惯性 + PWM 死区，记下每个编码器边沿的时间"""
+    gain = MOTOR_GAIN_CPS
+    deadzone = MOTOR_DEADZONE_PWM
+    tau_ms = MOTOR_TAU_MS
+
+    def __init__(self):
+        self.speed = 0.0
+        self.pos = 0.0
+        self.t_us = 0.0
+        self.edges = []          # (时间 us, 方向)，WheelSpeed 取走
+
+    def step(self, pwm, dt_ms):
+        drive = max(0.0, abs(pwm) - self.deadzone) * math.copysign(1.0, pwm)
+        target = self.gain * drive
+        v0 = self.speed
+        self.speed += (target - self.speed) * (1.0 - math.exp(-dt_ms / self.tau_ms))
+        # 这一步里按平均速度线性插值边沿时刻
+        v = (v0 + self.speed) / 2.0
+        new_pos = self.pos + v * dt_ms / 1000.0
+        lo, hi = sorted((self.pos, new_pos))
+        for k in range(math.floor(lo) + 1, math.floor(hi) + 1):
+            frac = (k - self.pos) / (new_pos - self.pos)
+            self.edges.append((self.t_us + frac * dt_ms * 1000.0, 1 if new_pos > self.pos else -1))
+        self.pos = new_pos
+        self.t_us += dt_ms * 1000.0
+
+    def run(self, pwm, dt_us):
+        pwm = min(max(pwm, 0.0), PWM_MAX)
+        steps = dt_us // 1000
+        for _ in range(steps):
+            self.step(pwm, 1.0)
+        if dt_us > steps * 1000:
+            self.step(pwm, (dt_us - steps * 1000) / 1000.0)
+
+    def count(self):
+        return math.floor(self.pos / COUNT_RES)
+
+
+class WheelSpeed:
+    """WheelSpeed_c::update()：低速周期法、高速计数法、中间线性混合"""
+
+    def __init__(self):
+        self.hist = []
+        self.last_dir = 0
+        self.last_count = 0
+        self.last_us = 0.0
+
+    def update(self, motor, now_us):
+        n_edges = 0
+        for t, d in motor.edges:
+            if d != self.last_dir:
+                self.hist = []
+                self.last_dir = d
+            self.hist = (self.hist + [t])[-SPEED_PERIOD_EDGES:]
+            n_edges += 1
+        motor.edges = []
+        count = motor.count()
+        dt = now_us - self.last_us
+        cps_count = (count - self.last_count) * 1e6 / dt if dt > 0 else 0.0
+        self.last_count, self.last_us = count, now_us
+        cps_period = 0.0
+        if len(self.hist) >= 2:
+            period = (self.hist[-1] - self.hist[0]) / (len(self.hist) - 1)
+            since = max(0.0, now_us - self.hist[-1])
+            period = max(period, since)
+            if since < SPEED_STOP_US and period > 0:
+                cps_period = self.last_dir * 1e6 / period
+            else:
+                self.hist = []
+        if n_edges >= SPEED_MIX_HI:
+            return cps_count
+        if n_edges <= SPEED_MIX_LO:
+            return cps_period
+        w = (n_edges - SPEED_MIX_LO) / (SPEED_MIX_HI - SPEED_MIX_LO)
+        return w * cps_count + (1.0 - w) * cps_period
+
+
+# 速度指令：(开始 ms, cps)，0 -> 500 -> 250 -> 0（PWM_MAX 60 时最高大约 600 cps）
+PROFILE = ((0, 500.0), (4000, 250.0), (8000, 0.0))
+
+
+def demand_profile(t_ms):
+    cps = 0.0
+    for t0, v in PROFILE:
+        if t_ms >= t0:
+            cps = v
+    return cps
+
+
+def periods(n, jitter_us, rng):
+    """每拍的实际周期（us）"""
+    base = PID_PERIOD_MS * 1000
+    if jitter_us <= 0:
+        return [base] * n
+    return [base + int(v) for v in rng.integers(-jitter_us, jitter_us + 1, size=n)]
+
+
+def closed_loop(pid, use_us, dts_us, log=None):
+    """带电机跑一遍，返回 (时间 ms, demand, 测得速度) 序列；log 记录每拍喂给 PID 的输入"""
+    motor = Motor()
+    ws = WheelSpeed()
+    t_us = 0
+    u = 0.0
+    out = []
+    for dt_us in dts_us:
+        # 这一拍之间电机按上一拍的 PWM 转（taskPID 里的 kF + u，限幅 0..PWM_MAX）
+        motor.run(KF_PWM + u, dt_us)
+        t_us += dt_us
+        meas = ws.update(motor, t_us)
+        demand = demand_profile(t_us / 1000.0)
+        # millis() 的差：两次调用之间的整数毫秒
+        dt_arg = dt_us if use_us else (t_us // 1000 - (t_us - dt_us) // 1000)
+        if log is not None:
+            log.append((demand, meas, dt_us, dt_arg))
+        u = pid.update(demand, meas, dt_arg)
+        out.append((t_us / 1000.0, demand, meas))
+    return out
+
+
+def settle_stats(trace, t0, t1, target, prev, band=0.05):
+    """[t0, t1) 这段指令下的调节时间和超调（按阶跃方向，相对阶跃幅度）
+    调节时间：进入 ±5% 以后不再出来；高速时测速是计数法，一拍差 1 个计数就是 25 cps，
+    5% 比这个小时按 1 个计数算"""
+    seg = [(t, m) for t, d, m in trace if t0 <= t < t1]
+    tol = max(band * abs(target), COUNT_RES * 1000.0 / PID_PERIOD_MS)
+    settle = None
+    for t, m in seg:
+        if abs(m - target) > tol:
+            settle = None
+        elif settle is None:
+            settle = t - t0
+    step = target - prev
+    over = max((m - target) / step for _, m in seg)
+    return settle, max(0.0, over)
+
+
+# ---------- 继电自整定（AutoTune.h / Follower.ino 的 autoTuneWheels()） ----------
+
+TUNE_SKIP_CYCLES = 2
+TUNE_MEAS_CYCLES = 4
+TUNE_BIAS_PWM = 8.0
+TUNE_RELAY_PWM = 6.0
+TUNE_HYST_CS = 15.0
+TUNE_TIMEOUT_MS = 10000
+FF_PWM_STEP = 4
+
+
+class RelayTune:
+    """RelayTune_c，float"""
+
+    def __init__(self, sp, bias, d, eps, now_ms):
+        self.sp, self.bias, self.d, self.eps = sp, bias, d, eps
+        self.high = True
+        self.cycles = 0
+        self.pmax, self.pmin = -1e9, 1e9
+        self.amp_sum = 0.0
+        self.period_sum = 0
+        self.last_rise = now_ms
+        self.done = False
+        self.ku = self.tu_ms = 0.0
+
+    def update(self, speed, now_ms):
+        if self.done:
+            return self.bias
+        self.pmax, self.pmin = max(self.pmax, speed), min(self.pmin, speed)
+        if self.high and speed > self.sp + self.eps:
+            self.high = False
+        elif not self.high and speed < self.sp - self.eps:
+            self.high = True
+            if self.cycles >= TUNE_SKIP_CYCLES:
+                self.amp_sum += (self.pmax - self.pmin) * 0.5
+                self.period_sum += now_ms - self.last_rise
+            self.cycles += 1
+            self.last_rise = now_ms
+            self.pmax, self.pmin = -1e9, 1e9
+            if self.cycles >= TUNE_SKIP_CYCLES + TUNE_MEAS_CYCLES:
+                a = self.amp_sum / TUNE_MEAS_CYCLES
+                self.tu_ms = self.period_sum / TUNE_MEAS_CYCLES
+                a2 = a * a - self.eps * self.eps
+                if a2 <= 0.0:
+                    a2 = a * a
+                self.ku = 4.0 * self.d / (math.pi * math.sqrt(a2))
+                self.done = True
+        return self.bias + self.d if self.high else self.bias - self.d
+
+    def gains(self, rule):
+        """换算成 PID_c 的参数（ki 每毫秒）"""
+        if rule == 'tl':
+            kp, ti = self.ku / 3.2, 2.2 * self.tu_ms
+        else:
+            kp, ti = 0.45 * self.ku, self.tu_ms / 1.2
+        return kp, kp / ti
+
+
+def relay_tune(rule):
+    """按 autoTuneWheels() 的流程跑一遍，返回 (RelayTune, 用时 ms)；没完成返回 (None, 用时)"""
+    motor = Motor()
+    ws = WheelSpeed()
+    # identifyFeedforward()：每 4 PWM 一档，死区上沿取最后一个没转的档
+    bias = (math.ceil(Motor.deadzone / FF_PWM_STEP) - 1) * FF_PWM_STEP + TUNE_BIAS_PWM
+    t_us = 0
+    # sampleSteadySpeed(500, 1000)
+    speeds = []
+    while t_us < 1500000:
+        motor.run(bias, PID_PERIOD_MS * 1000)
+        t_us += PID_PERIOD_MS * 1000
+        v = ws.update(motor, t_us)
+        if t_us > 500000:
+            speeds.append(v)
+    sp = sum(speeds) / len(speeds)
+    tune = RelayTune(sp, bias, TUNE_RELAY_PWM, TUNE_HYST_CS, t_us // 1000)
+    t_start = t_us
+    pwm = bias
+    while not tune.done and t_us - t_start < TUNE_TIMEOUT_MS * 1000:
+        motor.run(pwm, PID_PERIOD_MS * 1000)
+        t_us += PID_PERIOD_MS * 1000
+        pwm = tune.update(ws.update(motor, t_us), t_us // 1000)
+    return (tune if tune.done else None), (t_us - t_start) / 1000.0
+
+
+def relay_main(args, dts):
+    tune, took = relay_tune(args.rule)
+    if tune is None:
+        print(f"✗ 继电整定 {took / 1000:.1f}s 内没有完成")
+        sys.exit(1)
+    kp, ki = tune.gains(args.rule)
+    print(f"\n继电整定：setpoint {tune.sp:.0f} cps，bias {tune.bias:g} ± {tune.d:g} PWM，用时 {took / 1000:.1f}s")
+    print(f"Ku {tune.ku:.4f}，Tu {tune.tu_ms:.0f} ms -> kp {kp:.4f}，ki {ki:.6f}/ms（{args.rule.upper()} PI）")
+
+    print(f"\n{'指令段':>16s}{'手调 调节':>12s}{'整定 调节':>12s}{'手调 超调':>11s}{'整定 超调':>11s}")
+    hand = closed_loop(FixPID(args.kp, args.ki, args.kd), True, dts)
+    tuned = closed_loop(FixPID(kp, ki, 0.0), True, dts)
+    prev = 0.0
+    for (t0, target), (t1, _) in zip(PROFILE, PROFILE[1:]):
+        sh, oh = settle_stats(hand, t0, t1, target, prev)
+        st, ot = settle_stats(tuned, t0, t1, target, prev)
+        prev = target
+        fmt = lambda s: f"{s / 1000:.2f}s" if s is not None else f">{(t1 - t0) / 1000:g}s"
+        print(f"{f'{t0}-{t1}ms {target:.0f}':>16s}{fmt(sh):>12s}{fmt(st):>12s}{oh:10.1%}{ot:10.1%}")
+    print("\n✓ 仿真完成")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='轮速环 PID 仿真：Fix16 DualPID_c vs float PID_c')
+    parser.add_argument('--kp', type=float, default=0.04025, help='Follower.ino 的 KP_L')
+    parser.add_argument('--ki', type=float, default=0.00005, help='Follower.ino 的 KI_L（每毫秒）')
+    parser.add_argument('--kd', type=float, default=0.0)
+    parser.add_argument('--seconds', type=float, default=10.0)
+    parser.add_argument('--motor-gain', type=float, default=MOTOR_GAIN_CPS, help='死区以上每 PWM 的 counts/s')
+    parser.add_argument('--motor-tau-ms', type=float, default=MOTOR_TAU_MS)
+    parser.add_argument('--deadzone', type=float, default=MOTOR_DEADZONE_PWM, help='电机 PWM 死区')
+    parser.add_argument('--jitter-us', type=int, default=0, help='调度周期抖动 ±us')
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('--relay', action='store_true', help='跑一遍继电自整定，再比较手调和整定参数的阶跃响应')
+    parser.add_argument('--rule', default='zn', choices=('zn', 'tl'), help='TUNE_RULE：ZN / Tyreus-Luyben PI')
+    args = parser.parse_args()
+
+    Motor.gain, Motor.tau_ms, Motor.deadzone = args.motor_gain, args.motor_tau_ms, args.deadzone
+    n = int(args.seconds * 1000 / PID_PERIOD_MS)
+    rng = np.random.default_rng(args.seed)
+    dts = periods(n, args.jitter_us, rng)
+    print(f"kp {args.kp}, ki {args.ki}/ms, 周期 {PID_PERIOD_MS}ms ±{args.jitter_us}us, {n} 拍")
+    print(f"电机：{Motor.gain:g} cps/PWM，死区 {Motor.deadzone:g} PWM，τ {Motor.tau_ms:g} ms，前馈 {KF_PWM} PWM")
+
+    if args.relay:
+        relay_main(args, dts)
+        return
+
+    # 1. 回放：同一串输入
+    log = []
+    fl = FloatPID(args.kp, args.ki, args.kd)
+    trace_f = closed_loop(fl, False, dts, log)
+    fl2, fix = FloatPID(args.kp, args.ki, args.kd), FixPID(args.kp, args.ki, args.kd)
+    worst = 0.0
+    same = 0
+    for demand, meas, dt_us, dt_ms in log:
+        a = fl2.update(demand, meas, dt_ms)
+        b = fix.update(demand, meas, dt_us)
+        worst = max(worst, abs(a - b))
+        same += (a == b)
+    print(f"\n回放 {len(log)} 拍：Fix16 和 float 输出最大差 {worst:.4f} PWM（完全相同 {same} 拍）")
+
+    # 2. 闭环
+    trace_x = closed_loop(FixPID(args.kp, args.ki, args.kd), True, dts)
+    print(f"\n{'指令段':>16s}{'float 调节':>12s}{'Fix16 调节':>12s}{'float 超调':>11s}{'Fix16 超调':>11s}")
+    prev = 0.0
+    for (t0, target), (t1, _) in zip(PROFILE, PROFILE[1:]):
+        sf, of = settle_stats(trace_f, t0, t1, target, prev)
+        sx, ox = settle_stats(trace_x, t0, t1, target, prev)
+        prev = target
+        fmt = lambda s: f"{s / 1000:.2f}s" if s is not None else f">{(t1 - t0) / 1000:g}s"
+        print(f"{f'{t0}-{t1}ms {target:.0f}':>16s}{fmt(sf):>12s}{fmt(sx):>12s}{of:10.1%}{ox:10.1%}")
+    diff = max(abs(a[2] - b[2]) for a, b in zip(trace_f, trace_x))
+    print(f"闭环两者测得速度最大差 {diff:.1f} cps")
+    print("\n✓ 仿真完成")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()
@@ -0,0 +1,271 @@
+"""
+follower 锁相环（Follower/IrPll.h）的电脑仿真：看能不能锁上 leader 的 TDMA 帧
+
+按固件的做法逐拍模拟：
+  - leader：Tdma.h 的时间表，一帧两个时隙（先 bump 后 line），帧长可以比标称快 / 慢几个百分点
+    （两块板的时钟不一样），起始相位随机
+  - follower：taskSense 每 --sense-ms 一拍（带 ±--jitter-us 的抖动），每拍在后台测一次 bump，
+    测量开始的 micros() 作为这个读数的时刻，和 Follower.ino 一样 (左 + 右) / 2 喂给 IrPll_c
+  - bump 读数：leader 发 bump 的时隙里是跟随距离的读数（--near-us），发 line 的时隙里是
+    看不到 leader 的读数（--far-us），都加高斯噪声；测量横跨时隙切换时按开始时刻算
+IrPll_c 逐行移植（整数、移位、unsigned long 回绕），常数从 Tdma.h / IrPll.h 里解析。
+
+对每种帧长输出：锁定用时、锁定后预测的帧起点和真实帧起点的最大偏差、
+锁定后每帧用到几个读数（inBumpWindow）、用到的读数里有几个其实落在 line 时隙或保护带里。
+
+用法：
+    python simulate_pll.py
+    python simulate_pll.py --drift 0,2,-2 --sense-ms 5 --jitter-us 250 --seconds 20
+"""
+
+import argparse
+import os
+import re
+import sys
+
+import numpy as np
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+FOLLOWER = os.path.join(ROOT, 'Follower')
+
+U32 = 0xFFFFFFFF
+
+
+def read_defines(path, names):
+    """#define NAME 数字（或 #ifndef 里的默认值）"""
+    with open(path, 'r', encoding='utf-8', errors='ignore') as f:
+        text = f.read()
+    out = {}
+    for name in names:
+        m = re.search(rf'#define\s+{name}\s+(\d+)', text)
+        if not m:
+            raise ValueError(f"{path}: 找不到 {name}")
+        out[name] = int(m.group(1))
+    return out
+
+
+def s32(v):
+    v &= U32
+    return v - (1 << 32) if v & 0x80000000 else v
+
+
+class IrPll:
+    """IrPll_c，long 用 s32()，unsigned long 用 & U32"""
+
+    def __init__(self, consts, period, guard):
+        self.c = consts
+        self.nominal = period
+        self.guard = guard
+        self.period = period
+        self.edge_us = 0
+        self.frames = 0
+        self.phase_err = 0
+        self.locked = False
+        self.good = 0
+        self.have_edge = False
+        self.lo = U32
+        self.hi = 0
+        self.state = -1
+        self.last_t = 0
+
+    def sample(self, raw, t_us):
+        c = self.c
+        if raw < self.lo:
+            self.lo = raw
+        else:
+            self.lo += (raw - self.lo) >> c['PLL_ENV_SHIFT']
+        if raw > self.hi:
+            self.hi = raw
+        else:
+            self.hi -= (self.hi - raw) >> c['PLL_ENV_SHIFT']
+
+        self.advance(t_us)
+
+        if self.hi - self.lo < c['PLL_MIN_CONTRAST']:
+            self.state = -1
+            self.locked = False
+            self.good = 0
+            self.last_t = t_us
+            return
+
+        third = (self.hi - self.lo) // 3
+        s = self.state
+        if raw < self.lo + third:
+            s = 1
+        elif raw > self.hi - third:
+            s = 0
+
+        if self.state >= 0 and s != self.state:
+            t_edge = (self.last_t + ((t_us - self.last_t) & U32) // 2) & U32
+            self.edge(t_edge, s == 1)
+        self.state = s
+        self.last_t = t_us
+
+    def edge(self, t_edge, bump_start):
+        c = self.c
+        if not self.have_edge:
+            self.edge_us = t_edge if bump_start else (t_edge - self.period // 2) & U32
+            self.have_edge = True
+            return
+
+        self.advance(t_edge)
+        predicted = 0 if bump_start else self.period // 2
+        e = s32(t_edge - self.edge_us) - predicted
+        if e > self.period // 2:
+            e -= self.period
+        if e < -(self.period // 2):
+            e += self.period
+        self.phase_err = e
+
+        self.edge_us = (self.edge_us + (e >> c['PLL_KP_SHIFT'])) & U32
+        self.period += e >> c['PLL_KI_SHIFT']
+        hi = self.nominal + self.nominal // 10
+        lo = self.nominal - self.nominal // 10
+        self.period = min(max(self.period, lo), hi)
+
+        ae = abs(e)
+        if ae > 2 * self.guard:
+            self.locked = False
+            self.good = 0
+        elif ae < self.guard:
+            if self.good < c['PLL_LOCK_EDGES']:
+                self.good += 1
+            if self.good >= c['PLL_LOCK_EDGES']:
+                self.locked = True
+        else:
+            self.good = 0
+
+    def advance(self, t_us):
+        if not self.have_edge:
+            return
+        while s32(t_us - self.edge_us) >= self.period:
+            self.edge_us = (self.edge_us + self.period) & U32
+            if self.locked:
+                self.frames += 1
+
+    def phase(self, t_us):
+        self.advance(t_us)
+        p = s32(t_us - self.edge_us)
+        if p < 0:
+            p += self.period
+        return p
+
+    def in_bump_window(self, t_us):
+        if not self.locked:
+            return False
+        p = self.phase(t_us)
+        margin = 2 * self.guard
+        return margin <= p < self.period // 2 - margin
+
+
+def run(consts, frame_us, guard_us, drift, args, rng):
+    """一种帧长跑一遍，返回统计"""
+    leader_frame = frame_us * (1.0 + drift / 100.0)
+    leader_t0 = rng.uniform(0, leader_frame)     # leader 第一帧 bump 时隙开始的时刻（us）
+    # 从 micros() 一个比较大的值开始，顺便覆盖回绕
+    t_base = (1 << 32) - int(args.seconds * 1e6 / 2)
+    pll = IrPll(consts, frame_us, guard_us)
+
+    n = int(args.seconds * 1000 / args.sense_ms)
+    lock_t = None
+    max_err = 0.0
+    used = guard = wrong = 0
+    frames_locked = 0.0
+    t = 0.0
+    for _ in range(n):
+        t += args.sense_ms * 1000 + rng.uniform(-args.jitter_us, args.jitter_us)
+        ph = (t - leader_t0) % leader_frame
+        bump = ph < leader_frame / 2
+        raw = rng.normal(args.near_us if bump else args.far_us, args.noise_us)
+        raw = int(min(max(raw, 20), 4500))
+        t_us = (t_base + int(t)) & U32
+        was_locked = pll.locked
+        pll.sample(raw, t_us)
+        if pll.locked and lock_t is None:
+            lock_t = t
+        if not pll.locked:
+            if was_locked:
+                lock_t = None       # 失锁重新计时
+            continue
+        frames_locked += args.sense_ms * 1000 / leader_frame
+        # 预测的帧起点和真实帧起点的偏差（取最近的一个）
+        pred = pll.phase(t_us)
+        err = (pred - ph + leader_frame / 2) % leader_frame - leader_frame / 2
+        max_err = max(max_err, abs(err))
+        if pll.in_bump_window(t_us):
+            used += 1
+            # 真实相位：落在 line 时隙里算用错，落在 bump 时隙的保护带里只单独计数（读数还是对的）
+            if not bump:
+                wrong += 1
+            elif not (guard_us <= ph < leader_frame / 2 - guard_us):
+                guard += 1
+    per_frame = used / frames_locked if frames_locked else 0.0
+    return lock_t, max_err, per_frame, guard, wrong, used
+
+
+def main():
+    parser = argparse.ArgumentParser(description='IrPll_c 锁相仿真')
+    parser.add_argument('--drift', default='0,3,-3', help='leader 帧长比标称长几个百分点，逗号分隔')
+    parser.add_argument('--sense-ms', type=float, default=None,
+                        help='taskSense 周期，默认和 Follower.ino 的 SENSE_PERIOD_MS 一样取 TDMA_SLOT_MS / 4')
+    parser.add_argument('--jitter-us', type=float, default=250.0, help='每拍的时刻抖动 ±us')
+    parser.add_argument('--near-us', type=float, default=230.0, help='bump 时隙里的读数')
+    parser.add_argument('--far-us', type=float, default=900.0, help='line 时隙里的读数（看不到 leader）')
+    parser.add_argument('--noise-us', type=float, default=25.0)
+    parser.add_argument('--seconds', type=float, default=20.0)
+    parser.add_argument('--runs', type=int, default=20, help='每种帧长随机起始相位跑几次')
+    parser.add_argument('--seed', type=int, default=0)
+    args = parser.parse_args()
+
+    tdma = read_defines(os.path.join(FOLLOWER, 'Tdma.h'), ['TDMA_SLOT_MS', 'TDMA_GUARD_MS', 'TDMA_SLOTS'])
+    consts = read_defines(os.path.join(FOLLOWER, 'IrPll.h'),
+                          ['PLL_LOCK_EDGES', 'PLL_KP_SHIFT', 'PLL_KI_SHIFT', 'PLL_MIN_CONTRAST', 'PLL_ENV_SHIFT'])
+    frame_us = tdma['TDMA_SLOT_MS'] * tdma['TDMA_SLOTS'] * 1000
+    if args.sense_ms is None:
+        args.sense_ms = float(tdma['TDMA_SLOT_MS'] // 4)
+    guard_us = tdma['TDMA_GUARD_MS'] * 1000
+    print(f"帧 {frame_us / 1000:g}ms（时隙 {tdma['TDMA_SLOT_MS']}ms，保护带 {tdma['TDMA_GUARD_MS']}ms），"
+          f"采样 {args.sense_ms:g}ms ±{args.jitter_us:g}us，读数 {args.near_us:g}/{args.far_us:g} ±{args.noise_us:g}us")
+
+    rng = np.random.default_rng(args.seed)
+    print(f"\n{'帧长偏差':>8s}{'锁定用时(s)':>16s}{'最大相位偏差(ms)':>18s}{'每帧可用读数':>14s}"
+          f"{'落在保护带':>12s}{'用错':>8s}")
+    ok = True
+    total_wrong = 0
+    for drift in (float(v) for v in args.drift.split(',')):
+        locks, errs, per, guard, wrong, used = [], [], [], 0, 0, 0
+        for _ in range(args.runs):
+            lt, me, pf, g, w, u = run(consts, frame_us, guard_us, drift, args, rng)
+            if lt is None:
+                ok = False
+                continue
+            locks.append(lt / 1e6)
+            errs.append(me / 1000)
+            per.append(pf)
+            guard += g
+            wrong += w
+            used += u
+        total_wrong += wrong
+        if not locks:
+            print(f"{drift:+7.1f}%{'没锁上':>16s}")
+            continue
+        print(f"{drift:+7.1f}%{min(locks):8.2f}-{max(locks):<7.2f}{max(errs):18.2f}"
+              f"{np.mean(per):14.1f}{guard:>7d}/{used}{wrong:>5d}/{used}")
+
+    print()
+    if ok:
+        print("✓ 每次都锁上了")
+    else:
+        print("✗ 有的没锁上，见上面")
+        sys.exit(1)
+    if total_wrong:
+        print("✗ 有读数落在 line 时隙里还被当成 bump 用了：相位偏差超过了 inBumpWindow() 去掉的边，见上面的最大相位偏差")
+        sys.exit(1)
+    print("✓ 用到的读数都在 bump 时隙里")
+
+
+if __name__ == "__main__":
+    if sys.platform == 'win32':
+        import io
+        sys.stdout = io.TextIOWrapper(sys.stdout.buffer, encoding='utf-8')
+    main()